@@ -0,0 +1,567 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file benchmark_harness.h
+ *
+ * @brief Runs the maxflow engines on a graph file or a generated graph,
+ * timing every phase and checking the results, shared by the benchmark and
+ * the performance suite
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-16
+ *
+ */
+#ifndef MAXFLOWLIB_EXAMPLES_BENCHMARK_HARNESS_H
+#define MAXFLOWLIB_EXAMPLES_BENCHMARK_HARNESS_H
+
+#include "maxflow.h"
+#include "maxflow_bk.h"
+#include "maxflow_components.h"
+#include "maxflow_dual_decomposition.h"
+#include "maxflow_hpf.h"
+#include "maxflow_ibfs.h"
+#include "maxflow_ppr.h"
+#include "maxflow_presolve.h"
+#include "io/binary_graph.h"
+#include "io/compressed_graph.h"
+#include "io/dimacs_reader.h"
+#include "io/graph_generator.h"
+#include "util/memory_stats.h"
+#include "util/timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A graph file in any of the formats the benchmark reads: DIMACs, or
+ * a binary or compressed graph written by dimacs_to_binary or generate_graph,
+ * or a generated graph named gen:FAMILY:NODES[:SEED]. Opening it is the parse
+ * phase, create() the construct phase.
+ */
+class GraphFile {
+
+private:
+  std::unique_ptr<maxflowlib::io::BinaryGraphFile> m_binary;
+  std::unique_ptr<maxflowlib::io::CompressedGraphFile> m_compressed;
+  std::unique_ptr<maxflowlib::io::DimacsReader> m_dimacs;
+  std::unique_ptr<maxflowlib::io::GraphGenerator> m_generator;
+  unsigned m_num_threads;
+
+  /**
+   * @brief Sets up the generator of a gen:FAMILY:NODES[:SEED] name
+   */
+  void parse_generator(const std::string &name) {
+    using maxflowlib::io::GraphGenerator;
+    size_t family_end = name.find(':', 4);
+    if (family_end == std::string::npos) {
+      throw std::runtime_error("generated graph needs gen:FAMILY:NODES[:SEED]: " +
+                               name);
+    }
+    size_t nodes_end = name.find(':', family_end + 1);
+    std::string nodes = name.substr(family_end + 1, nodes_end - family_end - 1);
+    unsigned long long seed = 1;
+    if (nodes_end != std::string::npos) {
+      seed = std::strtoull(name.c_str() + nodes_end + 1, NULL, 10);
+    }
+    try {
+      m_generator.reset(new GraphGenerator(
+          GraphGenerator::parse_family(name.substr(4, family_end - 4)),
+          std::atoll(nodes.c_str()), seed));
+    } catch (const std::invalid_argument &e) {
+      throw std::runtime_error(std::string(e.what()) + ": " + name);
+    }
+  }
+
+public:
+  /**
+   * @brief Opens and checks a graph file
+   *
+   * @param filename the DIMACs format, binary or compressed graph file, or
+   * gen:FAMILY:NODES[:SEED]
+   * @param num_threads threads parsing or decoding the file, 0 uses the
+   * hardware concurrency
+   *
+   * @throws std::runtime_error if the file can not be read or is malformed
+   */
+  GraphFile(const std::string &filename, unsigned num_threads)
+      : m_num_threads(num_threads) {
+    if (!filename.compare(0, 4, "gen:")) {
+      parse_generator(filename);
+    } else if (maxflowlib::io::BinaryGraphFile::is_binary_graph(filename)) {
+      m_binary.reset(new maxflowlib::io::BinaryGraphFile(filename));
+    } else if (maxflowlib::io::CompressedGraphFile::is_compressed_graph(
+                   filename)) {
+      m_compressed.reset(new maxflowlib::io::CompressedGraphFile(filename));
+    } else {
+      m_dimacs.reset(new maxflowlib::io::DimacsReader(filename, num_threads));
+    }
+  }
+
+  int nnode() const {
+    return m_binary ? m_binary->nnode()
+                    : m_compressed ? m_compressed->nnode()
+                                   : m_generator ? m_generator->nnode()
+                                                 : m_dimacs->nnode();
+  }
+
+  /**
+   * @brief Allocates a graph and reads the file into it
+   *
+   * @return a pointer to an allocated Graph
+   */
+  template <typename Graph> Graph *create() const {
+    if (m_binary) {
+      return m_binary->create<Graph>();
+    }
+    if (m_compressed) {
+      return m_compressed->create<Graph>(m_num_threads);
+    }
+    if (m_generator) {
+      return m_generator->create<Graph>();
+    }
+    return m_dimacs->create<Graph>();
+  }
+};
+
+/**
+ * @brief Phases timed for every run of an engine
+ */
+enum Phase { PARSE, CONSTRUCT, INIT, SOLVE, READOUT, TOTAL, NPHASE };
+
+const char *const PHASE_NAMES[NPHASE] = {"parse", "construct", "init",
+                                         "solve", "readout",   "total"};
+
+/**
+ * @brief Summary statistics of the timings of a phase over the repetitions
+ */
+struct Summary {
+  double mean, median, p95, stddev, min, max;
+};
+
+/**
+ * @brief Summarizes timings, p95 is the nearest rank percentile
+ */
+inline Summary summarize(std::vector<double> seconds) {
+  Summary summary = {0, 0, 0, 0, 0, 0};
+  const size_t n = seconds.size();
+  if (n == 0) {
+    return summary;
+  }
+  std::sort(seconds.begin(), seconds.end());
+  for (double t : seconds) {
+    summary.mean += t;
+  }
+  summary.mean /= n;
+  for (double t : seconds) {
+    summary.stddev += (t - summary.mean) * (t - summary.mean);
+  }
+  summary.stddev = n > 1 ? std::sqrt(summary.stddev / (n - 1)) : 0.;
+  summary.median = n % 2 ? seconds[n / 2]
+                         : 0.5 * (seconds[n / 2 - 1] + seconds[n / 2]);
+  summary.p95 = seconds[std::min(n - 1, size_t(std::ceil(0.95 * n)) - 1)];
+  summary.min = seconds.front();
+  summary.max = seconds.back();
+  return summary;
+}
+
+/**
+ * @brief Memory use of a phase, the heap counts come from the allocator hook
+ * of util/memory_stats
+ */
+struct PhaseMemory {
+  size_t allocs;
+  size_t alloc_bytes;
+  // live heap and resident bytes at their highest during the phase, above
+  // what was live or resident when the run started
+  size_t peak_heap;
+  size_t peak_rss;
+};
+
+/**
+ * @brief Results of one run of an engine
+ */
+struct RunResult {
+  double seconds[NPHASE];
+  PhaseMemory memory[NPHASE];
+  long long flow;
+  long long sink_nodes;
+  // Graph::memory_bytes after the solve
+  size_t memory_bytes;
+  // segment of every node and the engine's own check of its flow, only
+  // filled for a verified run
+  std::vector<char> segments;
+  maxflowlib::FlowCheck flow_check;
+  std::string flow_error;
+};
+
+/**
+ * @brief Timings and results of the repetitions of one engine
+ */
+struct EngineResult {
+  std::string engine;
+  long long flow;
+  // nodes in the sink segment, a cheap fingerprint of the cut
+  long long sink_nodes;
+  // whether every repetition agreed on flow and sink_nodes
+  bool consistent;
+  std::vector<double> seconds[NPHASE];
+  // the largest of every count over the repetitions
+  PhaseMemory memory[NPHASE];
+  size_t memory_bytes;
+  // the last repetition is verified: the capacity of its cut, -1 when not
+  // verified, and the engine's check of its flow
+  std::vector<char> segments;
+  long long cut;
+  maxflowlib::FlowCheck flow_check;
+  std::string flow_error;
+};
+
+/**
+ * @brief Options of the benchmark harness
+ */
+struct BenchmarkOptions {
+  std::vector<std::string> engines;
+  int warmup;
+  int repeat;
+  unsigned num_threads;
+  std::string csv;
+  std::string json;
+  // check the cut and flow of every engine and that the engines agree
+  bool verify;
+
+  BenchmarkOptions() : warmup(0), repeat(1), num_threads(0), verify(true) {}
+};
+
+/**
+ * @brief Records the arcs of a graph file to evaluate the cuts found by the
+ * engines
+ */
+class RecordedGraph {
+
+public:
+  typedef int cap;
+
+  struct Arc {
+    int s, t, fcap, rcap;
+  };
+
+  int m_nnode;
+  std::vector<Arc> m_arcs;
+  std::vector<long long> m_scap, m_tcap;
+
+  RecordedGraph(int nnode, int narc)
+      : m_nnode(nnode), m_scap(nnode, 0), m_tcap(nnode, 0) {
+    m_arcs.reserve(narc);
+  }
+
+  void add_arc(int s, int t, int fcap, int rcap) {
+    Arc a = {s, t, fcap, rcap};
+    m_arcs.push_back(a);
+  }
+
+  void set_tweights(int s, int scap, int tcap) {
+    m_scap[s] += scap;
+    m_tcap[s] += tcap;
+  }
+
+  /**
+   * @brief Capacity of the cut separating the source segment (0) from the
+   * sink segment (1)
+   */
+  long long cut_capacity(const std::vector<char> &segments) const {
+    long long capacity = 0;
+    for (const Arc &a : m_arcs) {
+      if (!segments[a.s] && segments[a.t]) {
+        capacity += a.fcap;
+      } else if (segments[a.s] && !segments[a.t]) {
+        capacity += a.rcap;
+      }
+    }
+    for (int i = 0; i < m_nnode; ++i) {
+      capacity += segments[i] ? m_scap[i] : m_tcap[i];
+    }
+    return capacity;
+  }
+};
+
+/**
+ * @brief Runs an engine once on a file, timing every phase and recording its
+ * memory
+ *
+ * @tparam Graph the type of Graph/algorithm to use
+ * @param filename the graph file
+ * @param options the harness options
+ * @param verify whether to keep the segments and check the flow, after the
+ * timed phases
+ *
+ * @return the timings, memory and results of the run
+ */
+template <typename Graph>
+RunResult run_once(const std::string &filename, const BenchmarkOptions &options,
+                   bool verify) {
+  RunResult run;
+  util::Timer timers[NPHASE];
+  // peaks are counted above the heap and resident set at the start of the
+  // run, so what earlier runs left behind is not charged to this one
+  util::trim_heap();
+  const size_t heap_base = util::heap_bytes();
+  const size_t rss_base = util::rss_bytes();
+  // the counters are reset outside of the timed region
+  auto begin = [&](Phase phase) {
+    util::reset_alloc_stats();
+    util::reset_peak_rss();
+    timers[phase].tic();
+  };
+  auto end = [&](Phase phase) {
+    timers[phase].toc();
+    util::AllocStats stats = util::alloc_stats();
+    const size_t peak_rss = util::peak_rss_bytes();
+    PhaseMemory memory = {
+        stats.allocs, stats.bytes,
+        stats.peak_bytes > heap_base ? stats.peak_bytes - heap_base : 0,
+        peak_rss > rss_base ? peak_rss - rss_base : 0};
+    run.memory[phase] = memory;
+  };
+  timers[TOTAL].tic();
+  begin(PARSE);
+  GraphFile file(filename, options.num_threads);
+  end(PARSE);
+  begin(CONSTRUCT);
+  std::unique_ptr<Graph> g(file.create<Graph>());
+  end(CONSTRUCT);
+  begin(INIT);
+  g->init_graph();
+  end(INIT);
+  begin(SOLVE);
+  run.flow = g->maxflow();
+  end(SOLVE);
+  run.memory_bytes = g->memory_bytes();
+  begin(READOUT);
+  run.sink_nodes = 0;
+  for (int i = 0; i < file.nnode(); ++i) {
+    run.sink_nodes += g->what_segment(i);
+  }
+  end(READOUT);
+  timers[TOTAL].toc();
+  run.flow_check = maxflowlib::FLOW_UNCHECKED;
+  if (verify) {
+    run.segments.resize(file.nnode());
+    for (int i = 0; i < file.nnode(); ++i) {
+      run.segments[i] = g->what_segment(i);
+    }
+    run.flow_check = g->check_flow(run.flow_error);
+  }
+  PhaseMemory total = {0, 0, 0, 0};
+  for (int phase = 0; phase < TOTAL; ++phase) {
+    total.allocs += run.memory[phase].allocs;
+    total.alloc_bytes += run.memory[phase].alloc_bytes;
+    total.peak_heap = std::max(total.peak_heap, run.memory[phase].peak_heap);
+    total.peak_rss = std::max(total.peak_rss, run.memory[phase].peak_rss);
+  }
+  run.memory[TOTAL] = total;
+  for (int phase = 0; phase < NPHASE; ++phase) {
+    run.seconds[phase] = timers[phase].elapsed_seconds();
+  }
+  return run;
+}
+
+/**
+ * @brief Runs the warmups and repetitions of an engine
+ *
+ * @tparam Graph the type of Graph/algorithm to use
+ * @param engine the name reported for the engine
+ * @param filename the graph file
+ * @param options the harness options
+ *
+ * @return the timings and memory of the repetitions
+ */
+template <typename Graph>
+EngineResult benchmark_engine(const std::string &engine,
+                              const std::string &filename,
+                              const BenchmarkOptions &options) {
+  EngineResult result;
+  result.engine = engine;
+  result.flow = result.sink_nodes = -1;
+  result.consistent = true;
+  result.memory_bytes = 0;
+  result.cut = -1;
+  result.flow_check = maxflowlib::FLOW_UNCHECKED;
+  for (int phase = 0; phase < NPHASE; ++phase) {
+    PhaseMemory none = {0, 0, 0, 0};
+    result.memory[phase] = none;
+  }
+  const int nrun = options.warmup + options.repeat;
+  for (int k = 0; k < nrun; ++k) {
+    RunResult run =
+        run_once<Graph>(filename, options, options.verify && k + 1 == nrun);
+    if (result.flow >= 0 &&
+        (run.flow != result.flow || run.sink_nodes != result.sink_nodes)) {
+      result.consistent = false;
+    }
+    result.flow = run.flow;
+    result.sink_nodes = run.sink_nodes;
+    if (k >= options.warmup) {
+      for (int phase = 0; phase < NPHASE; ++phase) {
+        PhaseMemory &memory = result.memory[phase];
+        result.seconds[phase].push_back(run.seconds[phase]);
+        memory.allocs = std::max(memory.allocs, run.memory[phase].allocs);
+        memory.alloc_bytes =
+            std::max(memory.alloc_bytes, run.memory[phase].alloc_bytes);
+        memory.peak_heap =
+            std::max(memory.peak_heap, run.memory[phase].peak_heap);
+        memory.peak_rss = std::max(memory.peak_rss, run.memory[phase].peak_rss);
+      }
+      result.memory_bytes = std::max(result.memory_bytes, run.memory_bytes);
+    }
+    result.segments.swap(run.segments);
+    result.flow_check = run.flow_check;
+    result.flow_error = run.flow_error;
+  }
+  return result;
+}
+
+/**
+ * @brief Benchmarks one engine by name
+ *
+ * @return false if there is no engine of that name
+ */
+inline bool benchmark_engine(const std::string &engine,
+                             const std::string &filename,
+                             const BenchmarkOptions &options,
+                             EngineResult &result) {
+
+  using maxflowlib::GraphBK;
+  using maxflowlib::GraphIBFS;
+  using maxflowlib::GraphHPF;
+  using maxflowlib::GraphPPR;
+  using maxflowlib::GraphPresolve;
+  using maxflowlib::GraphComponents;
+  using maxflowlib::GraphDualDecomposition;
+
+  if (engine == "bk") {
+    result = benchmark_engine<GraphBK<int, int, int, int> >(engine, filename,
+                                                            options);
+  } else if (engine == "ibfs") {
+    result = benchmark_engine<GraphIBFS<int, int, int, int> >(engine, filename,
+                                                              options);
+  } else if (engine == "hpf") {
+    result = benchmark_engine<GraphHPF<int, int, int, int> >(engine, filename,
+                                                             options);
+  } else if (engine == "ppr") {
+    result = benchmark_engine<GraphPPR<int, int, int, int> >(engine, filename,
+                                                             options);
+  } else if (engine == "presolve_bk") {
+    result = benchmark_engine<GraphPresolve<GraphBK<int, int, int, int> > >(
+        engine, filename, options);
+  } else if (engine == "presolve_hpf") {
+    result = benchmark_engine<GraphPresolve<GraphHPF<int, int, int, int> > >(
+        engine, filename, options);
+  } else if (engine == "components_bk") {
+    result = benchmark_engine<GraphComponents<GraphBK<int, int, int, int> > >(
+        engine, filename, options);
+  } else if (engine == "dual_decomposition") {
+    result = benchmark_engine<GraphDualDecomposition<int, int, int, int> >(
+        engine, filename, options);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *const ENGINES[] = {"bk",           "ibfs",
+                               "hpf",          "ppr",
+                               "presolve_bk",  "presolve_hpf",
+                               "components_bk", "dual_decomposition"};
+
+const char *const FLOW_CHECK_NAMES[] = {"unchecked", "valid", "invalid"};
+
+/**
+ * @brief Checks that the cut found by every engine has the capacity of its
+ * flow, that the engines that can check their flow find it valid and that
+ * all engines agree on the maxflow. The graph is read again for the cuts
+ * once every engine has run, so it does not count in their memory.
+ *
+ * @return whether every check passed
+ */
+inline bool verify_results(const std::string &filename,
+                           const BenchmarkOptions &options,
+                           std::vector<EngineResult> &results) {
+  std::unique_ptr<RecordedGraph> recorded;
+  try {
+    recorded.reset(
+        GraphFile(filename, options.num_threads).create<RecordedGraph>());
+  } catch (const std::runtime_error &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    std::exit(EXIT_FAILURE);
+  }
+  bool verified = true;
+  for (EngineResult &r : results) {
+    const char *engine = r.engine.c_str();
+    bool ok = true;
+    r.cut = recorded->cut_capacity(r.segments);
+    std::vector<char>().swap(r.segments);
+    if (r.cut != r.flow) {
+      std::fprintf(stderr, "%s: cut capacity %lld differs from maxflow %lld\n",
+                   engine, r.cut, r.flow);
+      ok = false;
+    }
+    if (r.flow_check == maxflowlib::FLOW_INVALID) {
+      std::fprintf(stderr, "%s: %s\n", engine, r.flow_error.c_str());
+      ok = false;
+    }
+    if (r.flow != results[0].flow) {
+      std::fprintf(stderr, "%s: maxflow %lld differs from %lld of %s\n",
+                   engine, r.flow, results[0].flow,
+                   results[0].engine.c_str());
+      ok = false;
+    }
+    if (!r.consistent) {
+      std::fprintf(stderr, "%s: repetitions found different cuts\n", engine);
+      ok = false;
+    }
+    printf("%s: (VERIFY) : %s (CUT) : %lld (FLOW CHECK) : %s\n", engine,
+           ok ? "ok" : "FAILED", r.cut, FLOW_CHECK_NAMES[r.flow_check]);
+    verified = verified && ok;
+  }
+  return verified;
+}
+
+/**
+ * @brief Splits a comma separated list
+ */
+inline std::vector<std::string> split_list(const std::string &list) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > begin) {
+      items.push_back(list.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return items;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file dimacs_to_binary.cpp
+ *
+ * @brief Converts a DIMACS maxflow file to the binary or the compressed graph
+ * format
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-12
+ *
+ */
+#include "io/binary_graph.h"
+#include "io/compressed_graph.h"
+#include "io/dimacs_reader.h"
+#include "util/timer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+int main(int argc, char *argv[]) {
+
+  const bool compressed = argc > 1 && !std::strcmp(argv[1], "--compressed");
+  if (compressed) {
+    --argc;
+    ++argv;
+  }
+  if (argc < 3) {
+    printf("usage: %s [--compressed] DIMACS_MAXFLOW_FILE GRAPH_FILE "
+           "[NUM_THREADS]\n",
+           argv[0]);
+    std::exit(EXIT_SUCCESS);
+  }
+
+  try {
+    util::Timer timer;
+    timer.tic();
+    maxflowlib::io::DimacsReader reader(argv[1],
+                                        argc > 3 ? std::atoi(argv[3]) : 0);
+    if (compressed) {
+      maxflowlib::io::CompressedGraphWriter writer(reader.nnode(),
+                                                   int(reader.narc()));
+      reader.read(writer);
+      writer.write(argv[2]);
+    } else {
+      maxflowlib::io::BinaryGraphWriter writer(reader.nnode(),
+                                               int(reader.narc()));
+      reader.read(writer);
+      writer.write(argv[2]);
+    }
+    timer.toc();
+    printf("wrote %d nodes and %zu arcs to %s (TIME) : %fs\n", reader.nnode(),
+           reader.narc(), argv[2], timer.elapsed_seconds());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    std::exit(EXIT_FAILURE);
+  }
+  return 0;
+}
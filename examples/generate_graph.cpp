@@ -0,0 +1,103 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file generate_graph.cpp
+ *
+ * @brief Generates a synthetic maxflow benchmark instance into the binary or
+ * the compressed graph format
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-15
+ *
+ */
+#include "io/binary_graph.h"
+#include "io/compressed_graph.h"
+#include "io/graph_generator.h"
+#include "util/timer.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+void usage(const char *program) {
+  printf("usage: %s [--compressed] [--seed SEED] [--max-cap CAP] "
+         "[--degree DEGREE] FAMILY NODES GRAPH_FILE\n\nfamilies:",
+         program);
+  for (int f = 0; f < maxflowlib::io::GraphGenerator::NFAMILY; ++f) {
+    printf(" %s", maxflowlib::io::GraphGenerator::FAMILY_NAMES[f]);
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+
+  using maxflowlib::io::GraphGenerator;
+
+  bool compressed = false;
+  unsigned long long seed = 1;
+  int max_cap = GraphGenerator::DEFAULT_MAX_CAP, degree = 0;
+  int argi = 1;
+  for (; argi < argc && !std::strncmp(argv[argi], "--", 2); ++argi) {
+    const bool has_value = argi + 1 < argc;
+    if (!std::strcmp(argv[argi], "--compressed")) {
+      compressed = true;
+    } else if (!std::strcmp(argv[argi], "--seed") && has_value) {
+      seed = std::strtoull(argv[++argi], NULL, 10);
+    } else if (!std::strcmp(argv[argi], "--max-cap") && has_value) {
+      max_cap = std::atoi(argv[++argi]);
+    } else if (!std::strcmp(argv[argi], "--degree") && has_value) {
+      degree = std::atoi(argv[++argi]);
+    } else {
+      usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  if (argc - argi < 3) {
+    usage(argv[0]);
+    std::exit(EXIT_SUCCESS);
+  }
+
+  try {
+    util::Timer timer;
+    timer.tic();
+    GraphGenerator generator(GraphGenerator::parse_family(argv[argi]),
+                             std::atoll(argv[argi + 1]), seed, max_cap,
+                             degree);
+    // a hint, the writers grow past it
+    const int narc = int(std::min(generator.narc(), size_t(INT_MAX)));
+    if (compressed) {
+      maxflowlib::io::CompressedGraphWriter writer(generator.nnode(), narc);
+      generator.generate(writer);
+      writer.write(argv[argi + 2]);
+    } else {
+      maxflowlib::io::BinaryGraphWriter writer(generator.nnode(), narc);
+      generator.generate(writer);
+      writer.write(argv[argi + 2]);
+    }
+    timer.toc();
+    printf("wrote %s %s, %d nodes and %zu arcs to %s (TIME) : %fs\n",
+           argv[argi], generator.shape().c_str(), generator.nnode(),
+           generator.narc(), argv[argi + 2], timer.elapsed_seconds());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    std::exit(EXIT_FAILURE);
+  }
+  return 0;
+}
@@ -24,223 +24,347 @@
  *
  */
 
-#include "maxflow.h"
-#include "maxflow_bk.h"
-#include "maxflow_hpf.h"
-#include "maxflow_ibfs.h"
+#include "benchmark_harness.h"
+#include "maxflow_undirected_slimcuts.h"
 #include "util/timer.h"
-#include <string>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 /**
- * @brief Stores arc to be added to graph as a post operation.
+ * @brief Reads a DIMACs format file, or a binary or compressed graph written
+ * by dimacs_to_binary, into a Graph defined by template
+ *
+ * @tparam Graph the type of graph
+ * @param filename the DIMACs format, binary or compressed graph file
+ * @param num_threads threads parsing or decoding the file, 0 uses the
+ * hardware concurrency
  *
- * @tparam Graph the graph type that is added to
- * @tparam dtype data type used for arc (assumes only one)
+ * @return a pointer to an allocated Graph
  */
-template <typename Graph, typename dtype = int> class DelayedAddArc {
-
-private:
-  dtype m_s, m_t, m_cap, m_rcap;
-
-public:
-  /**
-   * @brief Create a arc that will be added later
-   *
-   * @param s source node
-   * @param t target node
-   * @param cap forward capacity
-   * @param rcap reverse capacity
-   */
-  DelayedAddArc(dtype s, dtype t, dtype cap, dtype rcap)
-      : m_s(s), m_t(t), m_cap(cap), m_rcap(rcap) {}
-
-  /**
-   * @brief Adds arc to a graph
-   *
-   * @param g graph to add to
-   * @param source source node id
-   * @param sink sink node id
-   */
-  void add_arc(Graph &g, dtype source, dtype sink) const {
-    if (m_s == source) {
-      g.set_tweights(m_t - 3, m_cap, 0);
-    } else if (m_t == sink) {
-      g.set_tweights(m_s - 3, 0, m_cap);
-    } else {
-      g.add_arc(m_s - 3, m_t - 3, m_cap, 0);
-    }
+template <typename Graph>
+Graph *read_dimacs(const std::string &filename, unsigned num_threads = 0) {
+  try {
+    return GraphFile(filename, num_threads).create<Graph>();
+  } catch (const std::runtime_error &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    std::exit(EXIT_FAILURE);
   }
+}
 
-  /**
-   * @brief Checks to see if arc is a "real" arc or a source/sink arc
-   *
-   * @param source source id
-   * @param sink sink id
-   *
-   * @return  true if it is a source/sink arc
-   */
-  bool is_source_or_sink_arc(dtype source, dtype sink) const {
-    return m_s == source || m_t == sink;
+/**
+ * @brief Writes one row per engine and phase
+ */
+void write_csv(const std::string &path, const std::string &filename,
+               const BenchmarkOptions &options,
+               const std::vector<EngineResult> &results) {
+  FILE *stream = std::fopen(path.c_str(), "w");
+  if (!stream) {
+    std::string err_msg = "failed to open file for writing: " + path;
+    std::perror(err_msg.c_str());
+    std::exit(EXIT_FAILURE);
   }
-};
+  std::fprintf(stream, "file,engine,phase,warmup,repeat,mean,median,p95,"
+                       "stddev,min,max,flow,sink_nodes,consistent,allocs,"
+                       "alloc_bytes,peak_heap_bytes,peak_rss_bytes,"
+                       "memory_bytes,cut,flow_check\n");
+  for (const EngineResult &r : results) {
+    for (int phase = 0; phase < NPHASE; ++phase) {
+      Summary t = summarize(r.seconds[phase]);
+      const PhaseMemory &m = r.memory[phase];
+      std::fprintf(stream, "%s,%s,%s,%d,%d,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%lld,"
+                           "%lld,%d,%zu,%zu,%zu,%zu,%zu,%lld,%s\n",
+                   filename.c_str(), r.engine.c_str(), PHASE_NAMES[phase],
+                   options.warmup, options.repeat, t.mean, t.median, t.p95,
+                   t.stddev, t.min, t.max, r.flow, r.sink_nodes,
+                   int(r.consistent), m.allocs, m.alloc_bytes, m.peak_heap,
+                   m.peak_rss, r.memory_bytes, r.cut,
+                   FLOW_CHECK_NAMES[r.flow_check]);
+    }
+  }
+  std::fclose(stream);
+}
 
 /**
- * @brief Reads a DIMACs format file into a Graph defined by template
- *
- * @tparam Graph the type of graph
- * @param filename the DIMACs format file
- *
- * @return a pointer to an allocated Graph
+ * @brief Writes the results as one JSON object, with the raw timings of
+ * every repetition next to their summary and the memory of every phase
  */
-template <typename Graph> Graph *read_dimacs(const std::string &filename) {
-  Graph *g;
-  const int line_length = 1024;
-  char line[line_length];
-  int n, m, s, t, cap, source, sink;
-  char c;
-  std::vector<DelayedAddArc<Graph> > arcs_to_add;
-  FILE *stream = nullptr;
-  source = -1;
-  sink = -1;
-  if (!(stream = fopen(filename.c_str(), "r"))) {
-    std::string err_msg = "failed to open file for reading: " + filename;
+void write_json(const std::string &path, const std::string &filename,
+                const BenchmarkOptions &options,
+                const std::vector<EngineResult> &results) {
+  FILE *stream = std::fopen(path.c_str(), "w");
+  if (!stream) {
+    std::string err_msg = "failed to open file for writing: " + path;
     std::perror(err_msg.c_str());
     std::exit(EXIT_FAILURE);
   }
-  while (fgets(line, line_length, stream)) {
-    switch (*line) {
-    case 'p':
-      if (sscanf(line, "%*c %*s %d %d", &n, &m) != 2) {
-        std::string err_msg =
-            "p line is malformed in DIMACS file:" + filename + "\n";
-        std::fprintf(stderr, err_msg.c_str());
-        std::exit(EXIT_FAILURE);
-      }
-      break;
-    case 'a':
-      if (source == -1 || sink == -1) {
-        std::string err_msg =
-            "'a' line occured beforce setting source/sink in DIMACS file:" +
-            filename + "\n";
-        std::fprintf(stderr, err_msg.c_str());
-        std::exit(EXIT_FAILURE);
-      }
-      if (sscanf(line, "%*c %d %d %d", &s, &t, &cap) != 3) {
-        std::string err_msg =
-            "'a' line is malformed in DIMACS file:" + filename + "\n";
-        std::fprintf(stderr, err_msg.c_str());
-        std::exit(EXIT_FAILURE);
-      }
-      if (t == source || s == sink || (s == source && t == sink)) {
-        std::string err_msg =
-            "specified source or sink as target or source node incorrectly:" +
-            filename + "\n";
-        std::fprintf(stderr, err_msg.c_str());
-        std::exit(EXIT_FAILURE);
-      }
-      if ( cap > 0 ) {
-        arcs_to_add.emplace_back(s, t, cap, 0);
-      }
-      break;
-    case 'n':
-      if (sscanf(line, "%*c %d %c", &s, &c) != 2) {
-        std::string err_msg =
-            "'n' line is malformed in DIMACS file:" + filename + "\n";
-        std::fprintf(stderr, err_msg.c_str());
-        std::exit(EXIT_FAILURE);
-      }
-      if (c == 's') {
-        if (s != 1) {
-          std::string err_msg = "'n' line specified source as something else "
-                                "than 1, currently unsupported:" +
-                                filename + "\n";
-          std::fprintf(stderr, err_msg.c_str());
-          std::exit(EXIT_FAILURE);
-        }
-        source = s;
-      }
-      if (c == 't') {
-        if (s != 2) {
-          std::string err_msg = "'n' line specified sink as something else "
-                                "than 2, currently unsupported:" +
-                                filename + "\n";
-          std::fprintf(stderr, err_msg.c_str());
-          std::exit(EXIT_FAILURE);
-        }
-        sink = s;
-      }
-      break;
-    case 'c':
-      // comment
-      break;
-    default:
-      break;
+  std::string escaped;
+  for (char c : filename) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
     }
+    escaped += c;
   }
-  fclose(stream);
-  // Count the number of real arcs
-  int narcs = 0;
-  for (DelayedAddArc<Graph> &a : arcs_to_add) {
-    if (!a.is_source_or_sink_arc(source, sink)) {
-      narcs++;
+  std::fprintf(stream, "{\n  \"file\": \"%s\",\n  \"warmup\": %d,\n"
+                       "  \"repeat\": %d,\n  \"engines\": [",
+               escaped.c_str(), options.warmup, options.repeat);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const EngineResult &r = results[i];
+    std::fprintf(stream, "%s\n    {\n      \"engine\": \"%s\",\n"
+                         "      \"flow\": %lld,\n      \"sink_nodes\": %lld,\n"
+                         "      \"consistent\": %s,\n"
+                         "      \"memory_bytes\": %zu,\n      \"cut\": %lld,\n"
+                         "      \"flow_check\": \"%s\",\n      \"phases\": {",
+                 i ? "," : "", r.engine.c_str(), r.flow, r.sink_nodes,
+                 r.consistent ? "true" : "false", r.memory_bytes, r.cut,
+                 FLOW_CHECK_NAMES[r.flow_check]);
+    for (int phase = 0; phase < NPHASE; ++phase) {
+      Summary t = summarize(r.seconds[phase]);
+      std::fprintf(stream, "%s\n        \"%s\": {\"mean\": %.9f, "
+                           "\"median\": %.9f, \"p95\": %.9f, \"stddev\": %.9f, "
+                           "\"min\": %.9f, \"max\": %.9f, \"seconds\": [",
+                   phase ? "," : "", PHASE_NAMES[phase], t.mean, t.median,
+                   t.p95, t.stddev, t.min, t.max);
+      for (size_t k = 0; k < r.seconds[phase].size(); ++k) {
+        std::fprintf(stream, "%s%.9f", k ? ", " : "", r.seconds[phase][k]);
+      }
+      const PhaseMemory &m = r.memory[phase];
+      std::fprintf(stream, "], \"allocs\": %zu, \"alloc_bytes\": %zu, "
+                           "\"peak_heap_bytes\": %zu, \"peak_rss_bytes\": %zu}",
+                   m.allocs, m.alloc_bytes, m.peak_heap, m.peak_rss);
     }
+    std::fprintf(stream, "\n      }\n    }");
   }
-  // Create a graph with the correct number of arcs,
-  // add the arcs appropriately as either source/sink
-  // arcs or s,t arcs
-  g = new Graph(n - 2, narcs);
-  for (DelayedAddArc<Graph> &a : arcs_to_add) {
-    a.add_arc(*g, source, sink);
-  }
-  return g;
+  std::fprintf(stream, "\n  ]\n}\n");
+  std::fclose(stream);
 }
 
 /**
- * @brief Compute the maxflow given a DIMACs file
+ * @brief Benchmarks the selected maxflow algorithms, timing each phase over
+ * the repetitions
  *
- * @tparam Graph the type of Graph/algorithm to use
- * @param filename the DIMACs file
+ * @param filename DIMACs file for which to compute maxflow
+ * @param options the harness options
  *
- * @return the maxflow value
+ * @return false if the verification failed
  */
-template <typename Graph> int compute_maxflow(const std::string &filename) {
-  int flow;
-  auto *g = read_dimacs<Graph>(filename);
-  util::Timer maxflow_timer;
-  maxflow_timer.tic();
-  flow = g->maxflow();
-  maxflow_timer.toc();
-  delete g;
-  printf("%s: (MAXFLOW) : %d (TIME) : %lfs\n", __PRETTY_FUNCTION__, flow,
-         maxflow_timer.elapsed_seconds());
-  return flow;
+bool benchmark_maxflow(const std::string &filename,
+                       const BenchmarkOptions &options) {
+  std::vector<EngineResult> results;
+  for (const std::string &engine : options.engines) {
+    EngineResult result;
+    try {
+      if (!benchmark_engine(engine, filename, options, result)) {
+        std::fprintf(stderr, "unknown engine: %s\n", engine.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+    } catch (const std::runtime_error &e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      std::exit(EXIT_FAILURE);
+    }
+    const double MB = 1024. * 1024.;
+    Summary t[NPHASE];
+    for (int phase = 0; phase < NPHASE; ++phase) {
+      t[phase] = summarize(result.seconds[phase]);
+    }
+    printf("%s: (MAXFLOW) : %lld%s (PARSE) : %lfs (CONSTRUCT) : %lfs (INIT) : "
+           "%lfs (SOLVE) : %lfs [p95 %lfs, stddev %lfs] (READOUT) : %lfs "
+           "(TOTAL) : %lfs (MEMORY) : %.1fMB (PEAK HEAP) : %.1fMB (PEAK RSS) : "
+           "%.1fMB (ALLOCS) : %zu\n",
+           engine.c_str(), result.flow,
+           result.consistent ? "" : " (INCONSISTENT)", t[PARSE].median,
+           t[CONSTRUCT].median, t[INIT].median, t[SOLVE].median, t[SOLVE].p95,
+           t[SOLVE].stddev, t[READOUT].median, t[TOTAL].median,
+           result.memory_bytes / MB, result.memory[TOTAL].peak_heap / MB,
+           result.memory[TOTAL].peak_rss / MB, result.memory[TOTAL].allocs);
+    results.push_back(result);
+  }
+  bool verified = !options.verify || verify_results(filename, options, results);
+  if (!options.csv.empty()) {
+    write_csv(options.csv, filename, options, results);
+  }
+  if (!options.json.empty()) {
+    write_json(options.json, filename, options, results);
+  }
+  return verified;
 }
 
 /**
- * @brief Compute a rough benchmark on several different maxflow algorithms
+ * @brief Records the arcs of a DIMACs file, ignoring their direction, so
+ * they can be added to several undirected graphs and used to evaluate cuts.
+ */
+class RecordedUndirectedGraph {
+
+public:
+  typedef int cap;
+
+  struct Arc {
+    int s, t, cap;
+  };
+
+  int m_nnode;
+  std::vector<Arc> m_arcs;
+  std::vector<long long> m_scap, m_tcap;
+
+  RecordedUndirectedGraph(int nnode, int narc)
+      : m_nnode(nnode), m_scap(nnode, 0), m_tcap(nnode, 0) {
+    m_arcs.reserve(narc);
+  }
+
+  void add_arc(int s, int t, int fcap, int rcap) {
+    Arc a = {s, t, fcap + rcap};
+    m_arcs.push_back(a);
+  }
+
+  void set_tweights(int s, int scap, int tcap) {
+    m_scap[s] += scap;
+    m_tcap[s] += tcap;
+  }
+
+  /**
+   * @brief Adds the recorded arcs to an undirected graph
+   */
+  template <typename UndirectedGraph> void add_to(UndirectedGraph &g) const {
+    for (const Arc &a : m_arcs) {
+      g.add_arc(a.s, a.t, a.cap);
+    }
+    for (int i = 0; i < m_nnode; ++i) {
+      if (m_scap[i] || m_tcap[i]) {
+        g.set_tweights(i, m_scap[i], m_tcap[i]);
+      }
+    }
+  }
+
+  /**
+   * @brief Capacity of the cut given by the segments of a solved graph
+   */
+  template <typename UndirectedGraph>
+  long long cut_capacity(UndirectedGraph &g) const {
+    long long capacity = 0;
+    for (const Arc &a : m_arcs) {
+      if (g.what_segment(a.s) != g.what_segment(a.t)) {
+        capacity += a.cap;
+      }
+    }
+    for (int i = 0; i < m_nnode; ++i) {
+      capacity += g.what_segment(i) ? m_scap[i] : m_tcap[i];
+    }
+    return capacity;
+  }
+};
+
+/**
+ * @brief Sweeps the SlimCuts cutoff schedule on the undirected version of a
+ * DIMACs file, reporting the speed against the quality of the cut relative to
+ * the exact schedule.
  *
- * @param filename DIMACs file for which to compute maxflow
+ * @param filename DIMACs file for which to compute the cuts
+ * @param num_threads threads used to contract
  */
-void benchmark_maxflow(const std::string &filename) {
+void sweep_slimcuts_schedule(const std::string &filename,
+                             unsigned num_threads) {
+
+  typedef maxflowlib::UndirectedGraphSlimCuts<
+      maxflowlib::GraphBK<int, int, int, int> >
+      GraphSlimCuts;
+
+  RecordedUndirectedGraph *recorded =
+      read_dimacs<RecordedUndirectedGraph>(filename);
+
+  const double max_cutoffs[] = {1., 1.1, 1.2, 1.3, 1.4, 1.5, 2., 3.};
+  const int nschedules = sizeof(max_cutoffs) / sizeof(double);
+  long long exact_cut = -1;
+  for (int ischedule = 0; ischedule < nschedules; ++ischedule) {
+    maxflowlib::SlimCutsOptions options;
+    options.num_threads = num_threads;
+    options.cutoffs.clear();
+    for (double cutoff = 1.; cutoff <= max_cutoffs[ischedule] + 1e-9;
+         cutoff += 0.1) {
+      options.cutoffs.push_back(cutoff);
+    }
+    options.exact_only = ischedule == 0;
 
-  using maxflowlib::GraphBK;
-  using maxflowlib::GraphIBFS;
-  using maxflowlib::GraphHPF;
+    GraphSlimCuts g(recorded->m_nnode, options);
+    recorded->add_to(g);
+    util::Timer maxflow_timer;
+    maxflow_timer.tic();
+    g.maxflow();
+    maxflow_timer.toc();
+    long long cut = recorded->cut_capacity(g);
+    if (exact_cut < 0) {
+      exact_cut = cut;
+    }
+    const maxflowlib::SlimCutsStats &stats = g.stats();
+    printf("SlimCuts (MAX CUTOFF) : %.1f (NODES) : %zu -> %zu (ARCS) : %zu -> "
+           "%zu (CONTRACT) : %lfs (SOLVE) : %lfs (TIME) : %lfs (CUT) : %lld "
+           "(GAP) : %.4lf%%\n",
+           max_cutoffs[ischedule], stats.nodes_before, stats.nodes_after,
+           stats.arcs_before, stats.arcs_after, stats.contraction_seconds,
+           stats.solve_seconds, maxflow_timer.elapsed_seconds(), cut,
+           exact_cut ? 100. * (cut - exact_cut) / double(exact_cut) : 0.);
+  }
+  delete recorded;
+}
 
-  int bk_maxflow = compute_maxflow<GraphBK<int, int, int, int> >(filename);
-  int ibfs_maxflow = compute_maxflow<GraphIBFS<int, int, int, int> >(filename);
-  int hpf_maxflow = compute_maxflow<GraphHPF<int, int, int, int> >(filename);
+void usage(const char *program) {
+  printf("usage: %s DIMACS_MAXFLOW_FILE|GRAPH_FILE [OPTIONS]\n"
+         "       %s DIMACS_MAXFLOW_FILE|GRAPH_FILE --slimcuts [NUM_THREADS]\n"
+         "options:\n"
+         "  --engines LIST  comma separated engines to run (default all):\n"
+         "                  bk,ibfs,hpf,ppr,presolve_bk,presolve_hpf,\n"
+         "                  components_bk,dual_decomposition\n"
+         "  --warmup N      untimed runs per engine (default 0)\n"
+         "  --repeat N      timed runs per engine (default 1)\n"
+         "  --threads N     threads parsing the file, 0 for all (default 0)\n"
+         "  --csv FILE      write one row per engine and phase\n"
+         "  --json FILE     write the summaries and raw timings\n"
+         "  --no-verify     skip checking cuts, flows and that engines agree\n"
+         "GRAPH_FILE may also be gen:FAMILY:NODES[:SEED] for a generated "
+         "graph, see generate_graph\n",
+         program, program);
 }
 
 int main(int argc, char *argv[]) {
 
   if (argc < 2) {
-    printf("usage: %s DIMACS_MAXFLOW_FILE\n", argv[0]);
+    usage(argv[0]);
     std::exit(EXIT_SUCCESS);
   }
 
-  benchmark_maxflow(argv[1]);
+  if (argc > 2 && !std::strcmp(argv[2], "--slimcuts")) {
+    sweep_slimcuts_schedule(argv[1], argc > 3 ? std::atoi(argv[3]) : 1);
+    return 0;
+  }
+
+  BenchmarkOptions options;
+  options.engines.assign(ENGINES, ENGINES + sizeof(ENGINES) / sizeof(*ENGINES));
+  for (int i = 2; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--engines") && has_value) {
+      options.engines = split_list(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--warmup") && has_value) {
+      options.warmup = std::max(std::atoi(argv[++i]), 0);
+    } else if (!std::strcmp(argv[i], "--repeat") && has_value) {
+      options.repeat = std::max(std::atoi(argv[++i]), 1);
+    } else if (!std::strcmp(argv[i], "--threads") && has_value) {
+      options.num_threads = unsigned(std::max(std::atoi(argv[++i]), 0));
+    } else if (!std::strcmp(argv[i], "--csv") && has_value) {
+      options.csv = argv[++i];
+    } else if (!std::strcmp(argv[i], "--json") && has_value) {
+      options.json = argv[++i];
+    } else if (!std::strcmp(argv[i], "--no-verify")) {
+      options.verify = false;
+    } else {
+      usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!benchmark_maxflow(argv[1], options)) {
+    std::fprintf(stderr, "verification failed\n");
+    std::exit(EXIT_FAILURE);
+  }
 }
@@ -0,0 +1,696 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_perf_suite.cpp
+ *
+ * @brief Runs every engine on a fixed corpus of generated graphs and any
+ * given graph files, saves the timings as a JSON baseline and compares a new
+ * run against a baseline, failing on significant regressions
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-16
+ *
+ */
+
+#include "benchmark_harness.h"
+#include "util/mapped_file.h"
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <utility>
+
+/**
+ * @brief A generated graph of the corpus, the seed is fixed so every run
+ * solves the same graphs
+ */
+struct CorpusGraph {
+  const char *family;
+  long long nodes;
+};
+
+const CorpusGraph CORPUS[] = {
+    {"grid2d", 250000},  {"grid3d", 125000},  {"rlg_wide", 65536},
+    {"rlg_long", 65536}, {"ak", 8192},        {"layered", 100000},
+    {"matching", 100000}, {"genrmf", 8000}};
+
+const unsigned long long CORPUS_SEED = 1;
+
+/**
+ * @brief Phases compared against the baseline, parse and readout measure
+ * the harness more than the engines
+ */
+const Phase COMPARED_PHASES[] = {CONSTRUCT, INIT, SOLVE, TOTAL};
+
+/**
+ * @brief Options of the suite on top of the harness options
+ */
+struct SuiteOptions {
+  BenchmarkOptions benchmark;
+  double scale;
+  std::string save;
+  std::string baseline;
+  // a regression is a median slower by more than threshold that is
+  // significant at level alpha
+  double threshold;
+  double alpha;
+  // phases whose baseline median is below this are too noisy to compare
+  double min_seconds;
+
+  SuiteOptions()
+      : scale(1.), threshold(0.05), alpha(0.05), min_seconds(1e-3) {
+    benchmark.warmup = 1;
+    benchmark.repeat = 5;
+  }
+};
+
+/**
+ * @brief Results of every engine on one graph of the corpus
+ */
+struct CaseResult {
+  std::string graph;
+  std::string engine;
+  long long flow;
+  bool verified;
+  std::vector<double> seconds[NPHASE];
+};
+
+/**
+ * @brief A parsed JSON value, just enough of JSON to read back a baseline
+ */
+struct JsonValue {
+  enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+  Type type;
+  bool boolean;
+  double number;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue> > object;
+
+  JsonValue() : type(NUL), boolean(false), number(0) {}
+
+  /**
+   * @brief Member of an object
+   *
+   * @return the member, NULL if there is none of that name
+   */
+  const JsonValue *get(const std::string &key) const {
+    for (const std::pair<std::string, JsonValue> &member : object) {
+      if (member.first == key) {
+        return &member.second;
+      }
+    }
+    return NULL;
+  }
+};
+
+/**
+ * @brief Recursive descent JSON parser, throws std::runtime_error on
+ * malformed input
+ */
+class JsonParser {
+
+  const char *m_p, *m_end;
+
+  void fail(const std::string &what) const {
+    throw std::runtime_error("malformed JSON: " + what);
+  }
+
+  void skip_space() {
+    while (m_p < m_end && std::isspace((unsigned char)*m_p)) {
+      ++m_p;
+    }
+  }
+
+  void expect(char c) {
+    skip_space();
+    if (m_p == m_end || *m_p != c) {
+      fail(std::string("expected '") + c + "'");
+    }
+    ++m_p;
+  }
+
+  bool consume(const char *word) {
+    const size_t n = std::strlen(word);
+    if (size_t(m_end - m_p) >= n && !std::strncmp(m_p, word, n)) {
+      m_p += n;
+      return true;
+    }
+    return false;
+  }
+
+  std::string parse_string() {
+    expect('"');
+    std::string s;
+    while (m_p < m_end && *m_p != '"') {
+      char c = *m_p++;
+      if (c == '\\') {
+        if (m_p == m_end) {
+          break;
+        }
+        c = *m_p++;
+        switch (c) {
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        case 'n':
+          c = '\n';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        case 'u':
+          // only the ASCII code points the suite writes
+          if (m_end - m_p < 4) {
+            fail("truncated \\u escape");
+          }
+          c = char(std::strtol(std::string(m_p, 4).c_str(), NULL, 16));
+          m_p += 4;
+          break;
+        default:
+          break;
+        }
+      }
+      s += c;
+    }
+    if (m_p == m_end) {
+      fail("unterminated string");
+    }
+    ++m_p;
+    return s;
+  }
+
+  JsonValue parse_value() {
+    JsonValue value;
+    skip_space();
+    if (m_p == m_end) {
+      fail("unexpected end");
+    }
+    if (*m_p == '{') {
+      value.type = JsonValue::OBJECT;
+      ++m_p;
+      skip_space();
+      if (m_p < m_end && *m_p == '}') {
+        ++m_p;
+        return value;
+      }
+      do {
+        std::string key = parse_string();
+        expect(':');
+        value.object.push_back(std::make_pair(key, parse_value()));
+        skip_space();
+      } while (m_p < m_end && *m_p == ',' && ++m_p);
+      expect('}');
+    } else if (*m_p == '[') {
+      value.type = JsonValue::ARRAY;
+      ++m_p;
+      skip_space();
+      if (m_p < m_end && *m_p == ']') {
+        ++m_p;
+        return value;
+      }
+      do {
+        value.array.push_back(parse_value());
+        skip_space();
+      } while (m_p < m_end && *m_p == ',' && ++m_p);
+      expect(']');
+    } else if (*m_p == '"') {
+      value.type = JsonValue::STRING;
+      value.string = parse_string();
+    } else if (consume("true")) {
+      value.type = JsonValue::BOOLEAN;
+      value.boolean = true;
+    } else if (consume("false")) {
+      value.type = JsonValue::BOOLEAN;
+    } else if (consume("null")) {
+      value.type = JsonValue::NUL;
+    } else {
+      // strtod needs a terminated string, numbers are short
+      const char *begin = m_p;
+      while (m_p < m_end && (std::isdigit((unsigned char)*m_p) ||
+                             std::strchr("+-.eE", *m_p))) {
+        ++m_p;
+      }
+      std::string number(begin, m_p);
+      char *end;
+      value.type = JsonValue::NUMBER;
+      value.number = std::strtod(number.c_str(), &end);
+      if (number.empty() || *end) {
+        fail("bad value");
+      }
+    }
+    return value;
+  }
+
+public:
+  JsonParser(const char *begin, const char *end) : m_p(begin), m_end(end) {}
+
+  JsonValue parse() {
+    JsonValue value = parse_value();
+    skip_space();
+    if (m_p != m_end) {
+      fail("trailing characters");
+    }
+    return value;
+  }
+};
+
+/**
+ * @brief Escapes a string for a JSON document
+ */
+std::string json_escape(const std::string &s) {
+  std::string escaped;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+/**
+ * @brief Writes the raw timings of every case as the baseline
+ */
+void write_baseline(const std::string &path, const SuiteOptions &options,
+                    const std::vector<CaseResult> &cases) {
+  FILE *stream = std::fopen(path.c_str(), "w");
+  if (!stream) {
+    std::string err_msg = "failed to open file for writing: " + path;
+    std::perror(err_msg.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  std::fprintf(stream, "{\n  \"warmup\": %d,\n  \"repeat\": %d,\n"
+                       "  \"scale\": %.17g,\n  \"cases\": [",
+               options.benchmark.warmup, options.benchmark.repeat,
+               options.scale);
+  for (size_t i = 0; i < cases.size(); ++i) {
+    const CaseResult &c = cases[i];
+    std::fprintf(stream, "%s\n    {\"graph\": \"%s\", \"engine\": \"%s\", "
+                         "\"flow\": %lld, \"verified\": %s, \"seconds\": {",
+                 i ? "," : "", json_escape(c.graph).c_str(),
+                 c.engine.c_str(), c.flow, c.verified ? "true" : "false");
+    for (int phase = 0; phase < NPHASE; ++phase) {
+      std::fprintf(stream, "%s\"%s\": [", phase ? ", " : "",
+                   PHASE_NAMES[phase]);
+      for (size_t k = 0; k < c.seconds[phase].size(); ++k) {
+        std::fprintf(stream, "%s%.9f", k ? ", " : "", c.seconds[phase][k]);
+      }
+      std::fprintf(stream, "]");
+    }
+    std::fprintf(stream, "}}");
+  }
+  std::fprintf(stream, "\n  ]\n}\n");
+  std::fclose(stream);
+}
+
+/**
+ * @brief Reads a baseline written by write_baseline
+ *
+ * @param scale set to the --scale of the baseline run
+ */
+std::vector<CaseResult> read_baseline(const std::string &path,
+                                      double &scale) {
+  std::vector<CaseResult> cases;
+  try {
+    util::MappedFile file(path);
+    JsonValue root = JsonParser(file.data(), file.data() + file.size()).parse();
+    const JsonValue *list = root.get("cases");
+    if (!list || list->type != JsonValue::ARRAY) {
+      throw std::runtime_error("missing cases");
+    }
+    const JsonValue *saved_scale = root.get("scale");
+    if (!saved_scale || saved_scale->type != JsonValue::NUMBER) {
+      throw std::runtime_error("missing scale");
+    }
+    scale = saved_scale->number;
+    for (const JsonValue &item : list->array) {
+      const JsonValue *graph = item.get("graph"), *engine = item.get("engine");
+      const JsonValue *flow = item.get("flow"), *seconds = item.get("seconds");
+      if (!graph || !engine || !flow || !seconds) {
+        throw std::runtime_error("incomplete case");
+      }
+      CaseResult c;
+      c.graph = graph->string;
+      c.engine = engine->string;
+      c.flow = (long long)flow->number;
+      c.verified = true;
+      for (int phase = 0; phase < NPHASE; ++phase) {
+        const JsonValue *samples = seconds->get(PHASE_NAMES[phase]);
+        if (samples) {
+          for (const JsonValue &t : samples->array) {
+            c.seconds[phase].push_back(t.number);
+          }
+        }
+      }
+      cases.push_back(c);
+    }
+  } catch (const std::runtime_error &e) {
+    std::fprintf(stderr, "%s in baseline: %s\n", e.what(), path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  return cases;
+}
+
+/**
+ * @brief One sided Mann-Whitney U test that the samples of x tend to be
+ * larger than those of y. The p-value is exact for small samples, counting
+ * the orderings of the ranks, and uses the normal approximation otherwise;
+ * ties count half and are rare for timings.
+ *
+ * @return the p-value
+ */
+double mann_whitney_greater(const std::vector<double> &x,
+                            const std::vector<double> &y) {
+  const size_t n = x.size(), m = y.size();
+  if (n == 0 || m == 0) {
+    return 1.;
+  }
+  double u = 0;
+  for (double a : x) {
+    for (double b : y) {
+      u += a > b ? 1. : a == b ? 0.5 : 0.;
+    }
+  }
+  const size_t umax = n * m;
+  if (umax <= 2500) {
+    // count[i][j][v]: orderings of i x's and j y's with U == v, built up
+    // from whether the largest value is an x (it beats all j y's) or a y
+    std::vector<std::vector<std::vector<double> > > count(
+        n + 1, std::vector<std::vector<double> >(m + 1));
+    for (size_t i = 0; i <= n; ++i) {
+      for (size_t j = 0; j <= m; ++j) {
+        std::vector<double> &c = count[i][j];
+        c.assign(i * j + 1, 0.);
+        if (i == 0 || j == 0) {
+          c[0] = 1.;
+          continue;
+        }
+        const std::vector<double> &xlast = count[i - 1][j];
+        const std::vector<double> &ylast = count[i][j - 1];
+        for (size_t v = 0; v < xlast.size(); ++v) {
+          c[v + j] += xlast[v];
+        }
+        for (size_t v = 0; v < ylast.size(); ++v) {
+          c[v] += ylast[v];
+        }
+      }
+    }
+    const std::vector<double> &c = count[n][m];
+    double total = 0, tail = 0;
+    // a tie rounds down, which only makes the test more conservative
+    const size_t observed = size_t(u);
+    for (size_t v = 0; v <= umax; ++v) {
+      total += c[v];
+      if (v >= observed) {
+        tail += c[v];
+      }
+    }
+    return tail / total;
+  }
+  const double mean = 0.5 * umax;
+  const double sd = std::sqrt(double(n) * m * (n + m + 1) / 12.);
+  // continuity corrected
+  const double z = (u - 0.5 - mean) / sd;
+  return 0.5 * std::erfc(z / std::sqrt(2.));
+}
+
+/**
+ * @brief Median of samples
+ */
+double median(const std::vector<double> &seconds) {
+  return summarize(seconds).median;
+}
+
+/**
+ * @brief Compares the cases of a run against the baseline, printing every
+ * significant change
+ *
+ * @return the number of failures: regressions, where a changed maxflow
+ * counts as one, cases of either side missing from the other, and one if
+ * no phase could be compared at all
+ */
+int compare_baseline(const std::vector<CaseResult> &cases,
+                     const std::vector<CaseResult> &baseline,
+                     const SuiteOptions &options) {
+  // the baseline cases, with whether the run has them
+  std::map<std::pair<std::string, std::string>,
+           std::pair<const CaseResult *, bool> >
+      index;
+  for (const CaseResult &c : baseline) {
+    index[std::make_pair(c.graph, c.engine)] = std::make_pair(&c, false);
+  }
+  int regressions = 0, improvements = 0, missing = 0, compared = 0;
+  for (const CaseResult &c : cases) {
+    auto found = index.find(std::make_pair(c.graph, c.engine));
+    if (found == index.end()) {
+      printf("%s %s: MISSING from the baseline\n", c.graph.c_str(),
+             c.engine.c_str());
+      ++missing;
+      continue;
+    }
+    found->second.second = true;
+    const CaseResult &base = *found->second.first;
+    if (c.flow != base.flow) {
+      printf("%s %s: REGRESSION maxflow %lld, baseline %lld\n",
+             c.graph.c_str(), c.engine.c_str(), c.flow, base.flow);
+      ++regressions;
+    }
+    for (Phase phase : COMPARED_PHASES) {
+      const double before = median(base.seconds[phase]);
+      const double after = median(c.seconds[phase]);
+      if (before < options.min_seconds || after <= 0) {
+        continue;
+      }
+      ++compared;
+      const double ratio = after / before;
+      const char *change = NULL;
+      double p = 1.;
+      if (ratio > 1. + options.threshold) {
+        p = mann_whitney_greater(c.seconds[phase], base.seconds[phase]);
+        if (p < options.alpha) {
+          change = "REGRESSION";
+          ++regressions;
+        }
+      } else if (ratio < 1. - options.threshold) {
+        p = mann_whitney_greater(base.seconds[phase], c.seconds[phase]);
+        if (p < options.alpha) {
+          change = "improvement";
+          ++improvements;
+        }
+      }
+      if (change) {
+        printf("%s %s: %s (%s) : %lfs -> %lfs (%+.1lf%%) (P) : %.4lf\n",
+               c.graph.c_str(), c.engine.c_str(), change, PHASE_NAMES[phase],
+               before, after, 100. * (ratio - 1.), p);
+      }
+    }
+  }
+  for (const auto &entry : index) {
+    if (!entry.second.second) {
+      printf("%s %s: MISSING from this run\n", entry.first.first.c_str(),
+             entry.first.second.c_str());
+      ++missing;
+    }
+  }
+  printf("compared %d phases: %d regressions, %d improvements, %d missing "
+         "cases (threshold %.1lf%%, alpha %g)\n",
+         compared, regressions, improvements, missing,
+         100. * options.threshold, options.alpha);
+  if (compared == 0) {
+    printf("no phase was compared, the run does not match the baseline\n");
+    return regressions + missing + 1;
+  }
+  return regressions + missing;
+}
+
+/**
+ * @brief Graphs of the corpus followed by the given graph files
+ */
+std::vector<std::string> corpus_graphs(const SuiteOptions &options,
+                                       const std::vector<std::string> &files) {
+  std::vector<std::string> graphs;
+  for (const CorpusGraph &g : CORPUS) {
+    long long nodes = std::max(
+        (long long)(g.nodes * options.scale + 0.5), (long long)16);
+    graphs.push_back(std::string("gen:") + g.family + ":" +
+                     std::to_string(nodes) + ":" +
+                     std::to_string(CORPUS_SEED));
+  }
+  graphs.insert(graphs.end(), files.begin(), files.end());
+  return graphs;
+}
+
+/**
+ * @brief Runs every engine on every graph
+ *
+ * @return the cases, in order of graph then engine
+ */
+std::vector<CaseResult> run_suite(const std::vector<std::string> &graphs,
+                                  const SuiteOptions &options,
+                                  bool &verified) {
+  const BenchmarkOptions &benchmark = options.benchmark;
+  std::vector<CaseResult> cases;
+  verified = true;
+  for (const std::string &graph : graphs) {
+    printf("%s\n", graph.c_str());
+    std::vector<EngineResult> results;
+    for (const std::string &engine : benchmark.engines) {
+      EngineResult result;
+      if (!benchmark_engine(engine, graph, benchmark, result)) {
+        std::fprintf(stderr, "unknown engine: %s\n", engine.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      printf("%s: (MAXFLOW) : %lld (SOLVE) : %lfs (TOTAL) : %lfs\n",
+             engine.c_str(), result.flow, median(result.seconds[SOLVE]),
+             median(result.seconds[TOTAL]));
+      results.push_back(result);
+    }
+    bool graph_verified =
+        !benchmark.verify || verify_results(graph, benchmark, results);
+    verified = verified && graph_verified;
+    for (const EngineResult &r : results) {
+      CaseResult c;
+      c.graph = graph;
+      c.engine = r.engine;
+      c.flow = r.flow;
+      c.verified = graph_verified;
+      for (int phase = 0; phase < NPHASE; ++phase) {
+        c.seconds[phase] = r.seconds[phase];
+      }
+      cases.push_back(c);
+    }
+  }
+  return cases;
+}
+
+void usage(const char *program) {
+  printf("usage: %s [OPTIONS] [GRAPH_FILE...]\n"
+         "runs the engines on a fixed corpus of generated graphs and the "
+         "given graph files\n"
+         "options:\n"
+         "  --engines LIST     comma separated engines to run (default all)\n"
+         "  --warmup N         untimed runs per engine (default 1)\n"
+         "  --repeat N         timed runs per engine (default 5)\n"
+         "  --threads N        threads parsing files, 0 for all (default 0)\n"
+         "  --scale F          scale the generated graphs (default 1)\n"
+         "  --no-verify        skip checking cuts, flows and that engines "
+         "agree\n"
+         "  --save FILE        write the results as a JSON baseline\n"
+         "  --baseline FILE    compare against a baseline of the same --scale,\n"
+         "                     exit nonzero on a regression or on a case\n"
+         "                     missing from either side\n"
+         "  --threshold PCT    slowdown of the median that is a regression\n"
+         "                     (default 5)\n"
+         "  --alpha P          significance level of the Mann-Whitney test\n"
+         "                     (default 0.05)\n"
+         "  --min-seconds S    skip phases faster than this in the baseline\n"
+         "                     (default 0.001)\n"
+         "  --list             print the graphs and exit\n",
+         program);
+}
+
+int main(int argc, char *argv[]) {
+
+  SuiteOptions options;
+  BenchmarkOptions &benchmark = options.benchmark;
+  benchmark.engines.assign(ENGINES,
+                           ENGINES + sizeof(ENGINES) / sizeof(*ENGINES));
+  std::vector<std::string> files;
+  bool list = false;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--engines") && has_value) {
+      benchmark.engines = split_list(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--warmup") && has_value) {
+      benchmark.warmup = std::max(std::atoi(argv[++i]), 0);
+    } else if (!std::strcmp(argv[i], "--repeat") && has_value) {
+      benchmark.repeat = std::max(std::atoi(argv[++i]), 1);
+    } else if (!std::strcmp(argv[i], "--threads") && has_value) {
+      benchmark.num_threads = unsigned(std::max(std::atoi(argv[++i]), 0));
+    } else if (!std::strcmp(argv[i], "--scale") && has_value) {
+      options.scale = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--no-verify")) {
+      benchmark.verify = false;
+    } else if (!std::strcmp(argv[i], "--save") && has_value) {
+      options.save = argv[++i];
+    } else if (!std::strcmp(argv[i], "--baseline") && has_value) {
+      options.baseline = argv[++i];
+    } else if (!std::strcmp(argv[i], "--threshold") && has_value) {
+      options.threshold = std::atof(argv[++i]) / 100.;
+    } else if (!std::strcmp(argv[i], "--alpha") && has_value) {
+      options.alpha = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--min-seconds") && has_value) {
+      options.min_seconds = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--list")) {
+      list = true;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (options.scale <= 0) {
+    usage(argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::string> graphs = corpus_graphs(options, files);
+  if (list) {
+    for (const std::string &graph : graphs) {
+      printf("%s\n", graph.c_str());
+    }
+    return 0;
+  }
+
+  // read the baseline first so a bad file fails before the long run
+  std::vector<CaseResult> baseline;
+  if (!options.baseline.empty()) {
+    double scale;
+    baseline = read_baseline(options.baseline, scale);
+    if (std::fabs(scale - options.scale) > 1e-9 * options.scale) {
+      std::fprintf(stderr, "baseline %s was run with --scale %g, not %g\n",
+                   options.baseline.c_str(), scale, options.scale);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  bool verified;
+  std::vector<CaseResult> cases = run_suite(graphs, options, verified);
+  if (!options.save.empty()) {
+    write_baseline(options.save, options, cases);
+  }
+  int failures = 0;
+  if (!options.baseline.empty()) {
+    failures = compare_baseline(cases, baseline, options);
+  }
+  std::fflush(stdout);
+  if (!verified) {
+    std::fprintf(stderr, "verification failed\n");
+  }
+  if (failures) {
+    std::fprintf(stderr, "%d failures against %s\n", failures,
+                 options.baseline.c_str());
+  }
+  return verified && !failures ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -25,6 +25,7 @@
  *
  */
 
+#include <cmath>
 #include <complex>
 #include <cstdio>
 #include <cstdlib>
@@ -32,6 +33,7 @@
 
 #include "maxflow.h"
 #include "maxflow_bk.h"
+#include "maxflow_grid.h"
 #include "maxflow_hpf.h"
 #include "maxflow_ibfs.h"
 #include "maxflow_undirected.h"
@@ -39,6 +41,7 @@
 #include "util/timer.h"
 
 //#define USE_DIRECTED
+//#define USE_GRID
 
 template <typename vector> void create_unwrapping_grid(int size, vector &arc) {
   for (int y = 0; y < size; ++y) {
@@ -84,7 +87,10 @@ void solve_unwrapping_problem(int npt, const int_vector &arcs,
   while (iter++ < max_iter) {
     util::Timer timer_setup, timer_maxflow;
     timer_setup.tic();
-#ifdef USE_DIRECTED
+#if defined(USE_GRID)
+    const int size = int(std::lround(std::sqrt(double(npt))));
+    Graph graph(size, size);
+#elif defined(USE_DIRECTED)
     Graph graph(npt, narc);
 #else
     Graph graph(npt);
@@ -102,7 +108,7 @@ void solve_unwrapping_problem(int npt, const int_vector &arcs,
 //        int wgt = 10000 + (std::rand() % 100); // random
         int wgt = 1000; // uniform
       if (shifted_amb == 0) {
-#ifdef USE_DIRECTED
+#if defined(USE_DIRECTED) || defined(USE_GRID)
         graph.add_arc(s, t, wgt, wgt );
 #else
         graph.add_arc(s, t, wgt);
@@ -135,6 +141,13 @@ void solve_unwrapping_problem(int npt, const int_vector &arcs,
     fprintf(stderr, "mf=%ld\n", mf);
     fprintf(stderr, "setup time: %f, maxflow timer: %f\n",
             timer_setup.elapsed_seconds(), timer_maxflow.elapsed_seconds());
+#if !defined(USE_DIRECTED) && !defined(USE_GRID)
+    const maxflowlib::SlimCutsStats &stats = graph.stats();
+    fprintf(stderr, "supernodes: %zu/%zu, arcs: %zu/%zu, contraction time: %f, "
+                    "real maxflow time: %f\n",
+            stats.nodes_after, stats.nodes_before, stats.arcs_after,
+            stats.arcs_before, stats.contraction_seconds, stats.solve_seconds);
+#endif
     bool something_source = false;
     bool something_sink = false;
     for (int i = 0; i < npt; ++i) {
@@ -182,7 +195,9 @@ int main(int argc, char *argv[]) {
   create_unwrapping_grid(size, arcs);
   create_unwrapping_problem(gauss, arcs, ambigs);
 
-#ifdef USE_DIRECTED
+#if defined(USE_GRID)
+  typedef maxflowlib::GridGraph<int, int> GraphType;
+#elif defined(USE_DIRECTED)
     typedef  maxflowlib::GraphBK<int,int,int,int> GraphType;
 #else
   typedef maxflowlib::UndirectedGraphSlimCuts<
@@ -197,6 +197,14 @@ public:
 		last = first;
 	}
 
+	/* Returns the number of bytes allocated for all blocks */
+	size_t MemoryBytes() const
+	{
+		size_t bytes = 0;
+		for (block *b=first; b; b=b->next) bytes += sizeof(block) + (block_size-1)*sizeof(Type);
+		return bytes;
+	}
+
 /***********************************************************************/
 
 private:
@@ -269,6 +277,14 @@ public:
 		first_free = (block_item *) t;
 	}
 
+	/* Returns the number of bytes allocated for all blocks */
+	size_t MemoryBytes() const
+	{
+		size_t bytes = 0;
+		for (block *b=first; b; b=b->next) bytes += sizeof(block) + (block_size-1)*sizeof(block_item);
+		return bytes;
+	}
+
 /***********************************************************************/
 
 private:
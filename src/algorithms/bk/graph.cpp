@@ -16,7 +16,11 @@ template <typename captype, typename tcaptype, typename flowtype>
 	Graph<captype, tcaptype, flowtype>::Graph(int node_num_max, int edge_num_max, void (*err_function)(const char *))
 	: node_num(0),
 	  nodeptr_block(NULL),
-	  error_function(err_function)
+	  error_function(err_function),
+	  interrupt_function(NULL),
+	  interrupt_data(NULL),
+	  interrupt_counter(0),
+	  was_interrupted(false)
 {
 	if (node_num_max < 16) node_num_max = 16;
 	if (edge_num_max < 16) edge_num_max = 16;
@@ -135,6 +135,21 @@ public:
 	// to both the source and the sink, then default_segm is returned.
 	termtype what_segment(node_id i, termtype default_segm = SOURCE);
 
+	// If interrupt_function is not NULL, maxflow() calls it with interrupt_data
+	// every INTERRUPT_PERIOD iterations of its main loop and stops as soon as it
+	// returns true. The flow returned is then feasible (a lower bound on the
+	// maxflow) and what_segment() gives the cut of the current search trees.
+	void set_interrupt(bool (*interrupt_function)(void *), void *interrupt_data);
+
+	// The flow found so far and the capacity of the cut given by what_segment(),
+	// bounds on the maxflow that can also be read from the interrupt function.
+	// cut_capacity() takes time linear in the size of the graph.
+	flowtype current_flow() const { return flow; }
+	flowtype cut_capacity();
+
+	// Returns true if the last call to maxflow() was stopped by the interrupt function.
+	bool interrupted() const { return was_interrupted; }
+
 
 
 	//////////////////////////////////////////////
@@ -183,6 +198,9 @@ public:
 	int get_arc_num() { return (int)(arc_last - arcs); }
 	void get_arc_ends(arc_id a, node_id& i, node_id& j); // returns i,j to that a = i->j
 
+	// bytes allocated for nodes, arcs and the orphan list blocks
+	size_t get_memory_bytes() const;
+
 	///////////////////////////////////////////////////
 	// 3. Functions for reading residual capacities. //
 	///////////////////////////////////////////////////
@@ -327,6 +345,13 @@ private:
 
 	flowtype			flow;		// total flow
 
+	// stopping maxflow() early
+	static const int INTERRUPT_PERIOD = 1024;
+	bool				(*interrupt_function)(void *);
+	void				*interrupt_data;
+	int					interrupt_counter;
+	bool				was_interrupted;
+
 	// reusing trees & list of changed pixels
 	int					maxflow_iteration; // counter
 	Block<node_id>		*changed_list;
@@ -455,6 +480,13 @@ template <typename captype, typename tcaptype, typename flowtype>
 	j = (node_id) (a->head - nodes);
 }
 
+template <typename captype, typename tcaptype, typename flowtype> 
+	inline size_t Graph<captype,tcaptype,flowtype>::get_memory_bytes() const
+{
+	return (node_max - nodes)*sizeof(node) + (arc_max - arcs)*sizeof(arc)
+		+ (nodeptr_block ? nodeptr_block->MemoryBytes() : 0);
+}
+
 template <typename captype, typename tcaptype, typename flowtype> 
 	inline tcaptype Graph<captype,tcaptype,flowtype>::get_trcap(node_id i)
 {
@@ -484,6 +516,14 @@ template <typename captype, typename tcaptype, typename flowtype>
 }
 
 
+template <typename captype, typename tcaptype, typename flowtype> 
+	inline void Graph<captype,tcaptype,flowtype>::set_interrupt(bool (*_interrupt_function)(void *), void *_interrupt_data)
+{
+	interrupt_function = _interrupt_function;
+	interrupt_data = _interrupt_data;
+	interrupt_counter = 0;
+}
+
 template <typename captype, typename tcaptype, typename flowtype> 
 	inline typename Graph<captype,tcaptype,flowtype>::termtype Graph<captype,tcaptype,flowtype>::what_segment(node_id i, termtype default_segm)
 {
@@ -468,6 +468,31 @@ template <typename captype, typename tcaptype, typename flowtype>
 
 /***********************************************************************/
 
+template <typename captype, typename tcaptype, typename flowtype> 
+	flowtype Graph<captype,tcaptype,flowtype>::cut_capacity()
+{
+	// the flow plus the residual capacity leaving the source side, which is
+	// everything outside the sink tree
+	flowtype cut = flow;
+	node *i;
+	arc *a;
+
+	for (i=nodes; i<node_last; i++)
+	{
+		if (i->parent && i->is_sink)
+		{
+			if (i->tr_cap > 0) cut += i->tr_cap;
+			continue;
+		}
+		if (i->tr_cap < 0) cut -= i->tr_cap;
+		for (a=i->first; a; a=a->next)
+		{
+			if (a->head->parent && a->head->is_sink) cut += a->r_cap;
+		}
+	}
+	return cut;
+}
+
 template <typename captype, typename tcaptype, typename flowtype> 
 	flowtype Graph<captype,tcaptype,flowtype>::maxflow(bool reuse_trees, Block<node_id>* _changed_list)
 {
@@ -486,12 +511,19 @@ template <typename captype, typename tcaptype, typename flowtype>
 
 	if (reuse_trees) maxflow_reuse_trees_init();
 	else             maxflow_init();
+	was_interrupted = false;
 
 	// main loop
 	while ( 1 )
 	{
 		// test_consistency(current_node);
 
+		if (interrupt_function && ++interrupt_counter >= INTERRUPT_PERIOD)
+		{
+			interrupt_counter = 0;
+			if ((*interrupt_function)(interrupt_data)) { was_interrupted = true; break; }
+		}
+
 		if ((i=current_node))
 		{
 			i -> next = NULL; /* remove active flag */
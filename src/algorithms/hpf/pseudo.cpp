@@ -76,8 +76,9 @@ typedef struct root {
 
 //---------------  Global variables ------------------
 static uint numNodes = 0;
+// arcList holds the arc of every node to the source or sink, at the index of
+// the node, followed by the countArcs real arcs
 static uint numArcs = 0;
-static uint numRealArcs = 0;
 static uint countArcs = 0;
 // Oddly enough, source and sink must start counting from 1 because of the
 // nature of this code
@@ -95,6 +96,14 @@ static Node *adjacencyList = NULL;
 static Root *strongRoots = NULL;
 static uint *labelCount = NULL;
 static Arc *arcList = NULL;
+// pseudoflowPhase1 calls interruptFunction every INTERRUPT_PERIOD roots
+#define INTERRUPT_PERIOD 1024
+static bool (*interruptFunction)(void *) = NULL;
+static void *interruptData = NULL;
+static int interrupted = 0;
+// allocated sizes, resetGraph reuses the arrays when large enough
+static uint allocNodes = 0;
+static uint allocArcs = 0;
 //-----------------------------------------------------
 
 static void initializeNode(Node *nd, const uint n) {
@@ -190,16 +199,41 @@ static void addOutOfTreeNode(Node *n, Arc *out) {
   ++n->numOutOfTree;
 }
 
-void allocateGraph(uint _numNodes, uint _numArcs) {
+static void initializeArrays(void) {
   uint i;
+  for (i = 0; i < numNodes; ++i) {
+    initializeRoot(&strongRoots[i]);
+    initializeNode(&adjacencyList[i], (i + 1));
+    labelCount[i] = 0;
+  }
+
+  // the real arcs are initialized as they are added
+  numArcs = numNodes - 2;
+  for (i = 0; i < numArcs; ++i) {
+    initializeArc(&arcList[i]);
+  }
+
+  countArcs = 0;
+  mincut = 0;
+#ifdef LOWEST_LABEL
+  lowestStrongLabel = 1;
+#else
+  highestStrongLabel = 1;
+#endif
+}
+
+void allocateGraph(uint _numNodes, uint _numArcs) {
+  // the arrays are global, a new graph replaces the previous one
+  freeGraph();
   // for nodes we need to account for two extra nodes:
   // - source
   // - sink
   numNodes = _numNodes + 2;
   // for arcs we need to account for:
   // 1. expect one arc for each node to connect to source or sink
-  numArcs = _numArcs + _numNodes;
-  numRealArcs = _numArcs;
+  // more arcs than _numArcs grow the array in add_arc
+  allocNodes = numNodes;
+  allocArcs = _numArcs + _numNodes;
   if ((adjacencyList = (Node *)malloc(numNodes * sizeof(Node))) == NULL) {
     printf("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
     exit(1);
@@ -215,19 +249,22 @@ void allocateGraph(uint _numNodes, uint _numArcs) {
     exit(1);
   }
 
-  if ((arcList = (Arc *)malloc(numArcs * sizeof(Arc))) == NULL) {
+  if ((arcList = (Arc *)malloc(allocArcs * sizeof(Arc))) == NULL) {
     printf("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
     exit(1);
   }
 
-  for (i = 0; i < numNodes; ++i) {
-    initializeRoot(&strongRoots[i]);
-    initializeNode(&adjacencyList[i], (i + 1));
-    labelCount[i] = 0;
-  }
+  initializeArrays();
+}
 
-  for (i = 0; i < numArcs; ++i) {
-    initializeArc(&arcList[i]);
+static void growArcs(void) {
+  // nothing points into arcList before initializeGraph, as in BK grow by half
+  allocArcs += allocArcs / 2 + 16;
+  Arc *arcListOld = arcList;
+  if ((arcList = (Arc *)realloc(arcListOld, allocArcs * sizeof(Arc))) ==
+      NULL) {
+    printf("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+    exit(1);
   }
 }
 
@@ -242,16 +279,22 @@ void add_arc(uint from, uint to, uint fcap, uint rcap) {
         "HPF can not support both fcap and rcap > 0 on a given arc.");
   }
 
+  if (numArcs == allocArcs) {
+    growArcs();
+  }
+  Arc *ac = &arcList[numArcs];
+  initializeArc(ac);
   if (fcap > 0) {
-    arcList[countArcs].from = &adjacencyList[from + 2];
-    arcList[countArcs].to = &adjacencyList[to + 2];
-    arcList[countArcs].capacity = fcap;
+    ac->from = &adjacencyList[from + 2];
+    ac->to = &adjacencyList[to + 2];
+    ac->capacity = fcap;
   } else if (rcap > 0) {
-    arcList[countArcs].from = &adjacencyList[to + 2];
-    arcList[countArcs].to = &adjacencyList[from + 2];
-    arcList[countArcs].capacity = rcap;
+    ac->from = &adjacencyList[to + 2];
+    ac->to = &adjacencyList[from + 2];
+    ac->capacity = rcap;
   }
   countArcs++;
+  numArcs++;
   ++adjacencyList[from + 2].numAdjacent;
   ++adjacencyList[to + 2].numAdjacent;
 }
@@ -259,15 +302,15 @@ void add_arc(uint from, uint to, uint fcap, uint rcap) {
 void add_term_arc(uint id, uint termid, uint cap) {
 
   if (termid == source) {
-    arcList[numRealArcs + id].from = &adjacencyList[termid - 1];
-    arcList[numRealArcs + id].to = &adjacencyList[id + 2];
-    arcList[numRealArcs + id].capacity = cap;
+    arcList[id].from = &adjacencyList[termid - 1];
+    arcList[id].to = &adjacencyList[id + 2];
+    arcList[id].capacity = cap;
     ++adjacencyList[id + 2].numAdjacent;
     ++adjacencyList[termid - 1].numAdjacent;
   } else if (termid == sink) {
-    arcList[numRealArcs + id].from = &adjacencyList[id + 2];
-    arcList[numRealArcs + id].to = &adjacencyList[termid - 1];
-    arcList[numRealArcs + id].capacity = cap;
+    arcList[id].from = &adjacencyList[id + 2];
+    arcList[id].to = &adjacencyList[termid - 1];
+    arcList[id].capacity = cap;
     ++adjacencyList[id + 2].numAdjacent;
     ++adjacencyList[termid - 1].numAdjacent;
   }
@@ -706,7 +749,9 @@ static Node *getHighestStrongRoot(void) {
 
 static void pseudoflowPhase1(void) {
   Node *strongRoot;
+  uint count = 0;
 
+  interrupted = 0;
 #ifdef LOWEST_LABEL
   while ((strongRoot = getLowestStrongRoot()))
 #else
@@ -714,6 +759,13 @@ static void pseudoflowPhase1(void) {
 #endif
   {
     processRoot(strongRoot);
+    if (interruptFunction && ++count == INTERRUPT_PERIOD) {
+      count = 0;
+      if ((*interruptFunction)(interruptData)) {
+        interrupted = 1;
+        return;
+      }
+    }
   }
 }
 
@@ -731,11 +783,35 @@ static ullint get_mincut(const uint gap) {
   return mincut;
 }
 
-static uint checkOptimality(const uint gap) {
-  uint i, check = 1;
-  ullint mincut = 0;
+ullint flowLowerBound(void) {
+  // decomposing the pseudoflow into paths, at most the total deficit of the
+  // flow into the sink does not start at the source
+  llint bound = 0;
+  uint i;
+  for (i = 0; i < numArcs; ++i) {
+    if (arcList[i].to && arcList[i].to->number == sink) {
+      bound += arcList[i].flow;
+    }
+  }
+  for (i = 2; i < numNodes; ++i) {
+    if (adjacencyList[i].excess < 0) {
+      bound += adjacencyList[i].excess;
+    }
+  }
+  return bound > 0 ? (ullint)bound : 0;
+}
+
+int checkOptimality(void) {
+  uint i, gap, feasible = 1;
+  ullint cut = 0;
   llint *excess = NULL;
 
+#ifdef LOWEST_LABEL
+  gap = lowestStrongLabel;
+#else
+  gap = numNodes;
+#endif
+
   excess = (llint *)malloc(numNodes * sizeof(llint));
   if (!excess) {
     printf("%s Line %d: Out of memory\n", __FILE__, __LINE__);
@@ -751,11 +827,11 @@ static uint checkOptimality(const uint gap) {
       continue;
     }
     if ((arcList[i].from->label >= gap) && (arcList[i].to->label < gap)) {
-      mincut += arcList[i].capacity;
+      cut += arcList[i].capacity;
     }
 
-    if ((arcList[i].flow > arcList[i].capacity) || (arcList[i].flow < 0)) {
-      check = 0;
+    if (arcList[i].flow > arcList[i].capacity) {
+      feasible = 0;
       printf("c Capacity constraint violated on arc (%d, %d). Flow = %d, "
              "capacity = %d\n",
              arcList[i].from->number, arcList[i].to->number, arcList[i].flow,
@@ -768,33 +844,22 @@ static uint checkOptimality(const uint gap) {
   for (i = 0; i < numNodes; i++) {
     if ((i != (source - 1)) && (i != (sink - 1))) {
       if (excess[i]) {
-        check = 0;
+        feasible = 0;
         printf("c Flow balance constraint violated in node %d. Excess = %lld\n",
                i + 1, excess[i]);
       }
     }
   }
 
-  if (check) {
-    printf("c\nc Solution checks as feasible.\n");
-  }
-
-  check = 1;
-
-  if (excess[sink - 1] != mincut) {
-    check = 0;
-    printf("c Flow is not optimal - max flow does not equal min cut!\nc\n");
-  }
-
-  if (check) {
-    printf("c\nc Solution checks as optimal.\nc \n");
-    printf("s Max Flow            : %lld\n", mincut);
+  if (excess[sink - 1] != (llint)cut) {
+    feasible = 0;
+    printf("c Flow is not optimal - max flow does not equal min cut!\n");
   }
 
   free(excess);
   excess = NULL;
 
-  return mincut;
+  return feasible;
 }
 
 static void quickSort(Arc **arr, const uint first, const uint last) {
@@ -1040,8 +1105,48 @@ static void freeMemory(void) {
   free(labelCount);
 
   free(arcList);
+
+  adjacencyList = NULL;
+  strongRoots = NULL;
+  labelCount = NULL;
+  arcList = NULL;
+  numNodes = 0;
+  allocNodes = 0;
+  allocArcs = 0;
+}
+
+void freeGraph(void) {
+  if (adjacencyList != NULL) {
+    freeMemory();
+  }
 }
 
+void resetGraph(uint _numNodes, uint _numArcs) {
+  uint i;
+  if (adjacencyList == NULL || _numNodes + 2 > allocNodes ||
+      _numArcs + _numNodes > allocArcs) {
+    allocateGraph(_numNodes, _numArcs);
+    return;
+  }
+
+  for (i = 0; i < numNodes; ++i) {
+    if (adjacencyList[i].outOfTree) {
+      free(adjacencyList[i].outOfTree);
+    }
+  }
+  numNodes = _numNodes + 2;
+  initializeArrays();
+}
+
+ullint cutUpperBound(void) { return get_mincut(numNodes); }
+
+void setInterrupt(bool (*_interruptFunction)(void *), void *_interruptData) {
+  interruptFunction = _interruptFunction;
+  interruptData = _interruptData;
+}
+
+int isInterrupted() { return interrupted; }
+
 ullint pseudoflow() {
   pseudoflowPhase1();
   mincut = get_mincut(numNodes);
@@ -1061,4 +1166,19 @@ ullint maxflow_from_pseudoflow() {
   return mincut;
 }
 
-int what_segment(uint id) { return adjacencyList[id].label < numNodes; }
+int what_segment(uint id) { return adjacencyList[id + 2].label < numNodes; }
+
+ullint memoryBytes(void) {
+  uint i;
+  ullint bytes = (ullint)allocNodes * (sizeof(Node) + sizeof(Root) + sizeof(uint)) +
+                 (ullint)allocArcs * sizeof(Arc);
+  if (adjacencyList == NULL) {
+    return 0;
+  }
+  for (i = 0; i < numNodes; ++i) {
+    if (adjacencyList[i].outOfTree) {
+      bytes += adjacencyList[i].numAdjacent * sizeof(Arc *);
+    }
+  }
+  return bytes;
+}
@@ -45,8 +45,25 @@ void add_arc(uint from, uint to, uint fcap, uint rcap = 0);
 void set_tweights(uint id, uint source_cap, uint sink_cap);
 void initializeGraph();
 void allocateGraph(uint _numNodes, uint _numArcs);
+void resetGraph(uint _numNodes, uint _numArcs);
+// frees the graph, allocateGraph frees the previous graph itself
+void freeGraph();
 ullint maxflow_from_pseudoflow();
 ullint pseudoflow();
 int what_segment(uint id);
+// pseudoflow() calls interruptFunction(interruptData) periodically and stops
+// once it returns true, what_segment then gives a valid cut of capacity
+// cutUpperBound() and flowLowerBound() a lower bound on the maxflow, both can
+// also be called from interruptFunction
+void setInterrupt(bool (*interruptFunction)(void *), void *interruptData);
+int isInterrupted();
+ullint flowLowerBound();
+ullint cutUpperBound();
+// after maxflow_from_pseudoflow, checks capacities and flow conservation of
+// the recovered flow and that it equals the cut, violations are printed,
+// returns 1 if the flow is a maximum flow
+int checkOptimality();
+// bytes held by the node, root, label and arc arrays and the out of tree lists
+ullint memoryBytes();
 
 #endif
@@ -76,9 +76,17 @@ IBFSGraph::IBFSGraph(IBFSInitMode a_initMode)
 	nodes = nodeEnd = NULL;
 	topLevelS = topLevelT = 0;
 	flow = 0;
+	interruptFunction = NULL;
+	interruptData = NULL;
+	interruptCounter = 0;
+	interrupted = false;
+	freeNodeSegment = 1;
 	memArcs = NULL;
+	memArcsSize = 0;
+	nodesSize = 0;
 	tmpArcs = NULL;
 	tmpEdges = tmpEdgeLast = NULL;
+	tmpEdgeEnd = tmpEdgeFixedEnd = NULL;
 	ptrs = NULL;
 	testFlow = 0;
 	testExcess = 0;
@@ -92,6 +100,7 @@ IBFSGraph::~IBFSGraph()
 {
 	delete []nodes;
 	delete []memArcs;
+	freeEdgeChunks();
 	orphanBuckets.free();
 	orphan3PassBuckets.free();
 	excessBuckets.free();
@@ -133,8 +142,15 @@ void IBFSGraph::initSize(int numNodes, int numEdges)
 		fprintf(stdout, "c allocating arcs... \t [%lu MB]\n", (unsigned long)arcMemsize/(1<<20));
 		fflush(stdout);
 	}
-	memArcs = new char[arcMemsize];
-	memset(memArcs, 0, (unsigned long long)sizeof(char)*arcMemsize);
+	if (memArcs == NULL || memArcsSize < arcMemsize) {
+		delete []memArcs;
+		memArcs = new char[arcMemsize];
+		memArcsSize = arcMemsize;
+	}
+	// in fast mode initGraphFast writes every arc and clears the unused ones
+	if (initMode == IB_INIT_COMPACT) {
+		memset(memArcs, 0, (unsigned long long)sizeof(char)*arcMemsize);
+	}
 	if (initMode == IB_INIT_FAST) {
 		tmpEdges = (TmpEdge*)(memArcs + arcRealMemsize);
 	} else if (initMode == IB_INIT_COMPACT) {
@@ -142,6 +158,8 @@ void IBFSGraph::initSize(int numNodes, int numEdges)
 		tmpArcs = (TmpArc*)(memArcs +arcMemsize -(unsigned long long)sizeof(TmpArc)*(unsigned long long)(numEdges*2));
 	}
 	tmpEdgeLast = tmpEdges; // will advance as edges are added
+	tmpEdgeEnd = tmpEdgeFixedEnd = tmpEdges + numEdges;
+	freeEdgeChunks();
 	arcs = (Arc*)memArcs;
 	arcEnd = arcs + numEdges*2;
 
@@ -151,21 +169,26 @@ void IBFSGraph::initSize(int numNodes, int numEdges)
 //		fflush(stdout);
 //	}
 	this->numNodes = numNodes;
-	nodes = new Node[numNodes+1];
+	if (nodes == NULL || nodesSize < numNodes+1) {
+		delete []nodes;
+		nodes = new Node[numNodes+1];
+		nodesSize = numNodes+1;
+	}
 	memset(nodes, 0, sizeof(Node)*(numNodes+1));
 	nodeEnd = nodes+numNodes;
-	active0.init((Node**)(arcEnd));
-	activeS1.init((Node**)(arcEnd) + numNodes);
-	activeT1.init((Node**)(arcEnd) + (2*numNodes));
-	if (IB_EXCESSES) {
-		ptrs = (Node**)(arcEnd) + (3*numNodes);
-		excessBuckets.init(nodes, ptrs, numNodes);
-	}
+	initLists();
+	orphan3PassBuckets.free();
 	orphan3PassBuckets.init(nodes, numNodes);
+	orphanBuckets.free();
 	orphanBuckets.init(nodes, numNodes);
 
 	// init members
 	flow = 0;
+	incList = NULL;
+	incLen = incIteration = 0;
+	uniqOrphansS = uniqOrphansT = 0;
+	augTimestamp = 0;
+	topLevelS = topLevelT = 0;
 
 	if (verbose) {
 		fprintf(stdout, "c sizeof(ptr) = %d bytes\n", (int)sizeof(Node*));
@@ -175,6 +198,93 @@ void IBFSGraph::initSize(int numNodes, int numEdges)
 }
 
 
+unsigned long long IBFSGraph::memoryBytes() const
+{
+	unsigned long long bytes = memArcsSize + (unsigned long long)nodesSize*sizeof(Node);
+	if (orphan3PassBuckets.buckets != NULL) bytes += sizeof(Node*)*(orphan3PassBuckets.allocLevels+1);
+	if (orphanBuckets.buckets != NULL) bytes += sizeof(Node*)*(orphanBuckets.allocLevels+1);
+	if (excessBuckets.buckets != NULL) bytes += sizeof(Node*)*(excessBuckets.allocLevels+1);
+	bytes += tmpEdgeChunks.size()*sizeof(TmpEdge)*IB_EDGE_CHUNK;
+	return bytes;
+}
+
+
+void IBFSGraph::initLists()
+{
+	// the lists live in the arcs memory, after the arcs
+	active0.init((Node**)(arcEnd));
+	activeS1.init((Node**)(arcEnd) + numNodes);
+	activeT1.init((Node**)(arcEnd) + (2*numNodes));
+	if (IB_EXCESSES) {
+		ptrs = (Node**)(arcEnd) + (3*numNodes);
+		excessBuckets.free();
+		excessBuckets.init(nodes, ptrs, numNodes);
+	}
+}
+
+void IBFSGraph::addEdgeChunk()
+{
+	if (initMode != IB_INIT_FAST) {
+		fprintf(stdout, "More edges than given to initSize!\n");
+		exit(1);
+	}
+	tmpEdgeChunks.push_back(new TmpEdge[IB_EDGE_CHUNK]);
+	tmpEdgeLast = tmpEdgeChunks.back();
+	tmpEdgeEnd = tmpEdgeLast + IB_EDGE_CHUNK;
+}
+
+void IBFSGraph::freeEdgeChunks()
+{
+	for (size_t i = 0; i < tmpEdgeChunks.size(); i++) {
+		delete []tmpEdgeChunks[i];
+	}
+	tmpEdgeChunks.clear();
+}
+
+long long IBFSGraph::numEdgesAdded()
+{
+	if (tmpEdgeChunks.empty()) return tmpEdgeLast-tmpEdges;
+	return (tmpEdgeFixedEnd-tmpEdges) +
+			(long long)IB_EDGE_CHUNK*(long long)(tmpEdgeChunks.size()-1) +
+			(tmpEdgeLast-tmpEdgeChunks.back());
+}
+
+char *IBFSGraph::reallocArcs(long long numEdges)
+{
+	// arcs followed by the lists, the edges stay where they are until copied
+	unsigned long long arcRealMemsize = (unsigned long long)sizeof(Arc)*(unsigned long long)(numEdges*2);
+	unsigned long long nodeMemsize = (unsigned long long)sizeof(Node**)*(unsigned long long)(numNodes*3) +
+			(IB_EXCESSES ? ((unsigned long long)sizeof(Node**)*(unsigned long long)(numNodes*2)) : 0);
+	char *memArcsOld = memArcs;
+	memArcsSize = arcRealMemsize + nodeMemsize;
+	memArcs = new char[memArcsSize];
+	arcs = (Arc*)memArcs;
+	arcEnd = arcs + numEdges*2;
+	initLists();
+	return memArcsOld;
+}
+
+void IBFSGraph::copyEdges(TmpEdge *te, TmpEdge *teEnd)
+{
+	Arc *a;
+	for (; te != teEnd; te++) {
+		a = (nodes+te->tail)->firstArc;
+		a->rev = (nodes+te->head)->firstArc;
+		a->head = nodes+te->head;
+		a->rCap = te->cap;
+		a->isRevResidual = (te->revCap != 0);
+
+		a = (nodes+te->head)->firstArc;
+		a->rev = (nodes+te->tail)->firstArc;
+		a->head = nodes+te->tail;
+		a->rCap = te->revCap;
+		a->isRevResidual = (te->cap != 0);
+
+		++((nodes+te->head)->firstArc);
+		++((nodes+te->tail)->firstArc);
+	}
+}
+
 void IBFSGraph::initNodes()
 {
 	Node *x;
@@ -197,8 +307,15 @@ void IBFSGraph::initNodes()
 void IBFSGraph::initGraphFast()
 {
 	Node *x;
-	TmpEdge *te;
 	Arc *a;
+	long long numEdges = numEdgesAdded();
+	char *memArcsOld = NULL;
+
+	// more edges than initSize made room for, move the arcs to memory
+	// of the right size, the edges are freed once copied
+	if (!tmpEdgeChunks.empty()) {
+		memArcsOld = reallocArcs(numEdges);
+	}
 
 	// calculate start arc offsets and labels for every node
 	nodes->firstArc = arcs;
@@ -209,22 +326,21 @@ void IBFSGraph::initGraphFast()
 	nodeEnd->label = arcEnd-arcs;
 
 	// copy arcs
-	for (te=tmpEdges; te != tmpEdgeLast; te++) {
-		a = (nodes+te->tail)->firstArc;
-		a->rev = (nodes+te->head)->firstArc;
-		a->head = nodes+te->head;
-		a->rCap = te->cap;
-		a->isRevResidual = (te->revCap != 0);
-
-		a = (nodes+te->head)->firstArc;
-		a->rev = (nodes+te->tail)->firstArc;
-		a->head = nodes+te->tail;
-		a->rCap = te->revCap;
-		a->isRevResidual = (te->cap != 0);
-
-		++((nodes+te->head)->firstArc);
-		++((nodes+te->tail)->firstArc);
+	if (tmpEdgeChunks.empty()) {
+		copyEdges(tmpEdges, tmpEdgeLast);
+	} else {
+		copyEdges(tmpEdges, tmpEdgeFixedEnd);
+		delete []memArcsOld;
+		for (size_t i = 0; i < tmpEdgeChunks.size(); i++) {
+			copyEdges(tmpEdgeChunks[i], i+1 == tmpEdgeChunks.size() ? tmpEdgeLast : tmpEdgeChunks[i]+IB_EDGE_CHUNK);
+			delete []tmpEdgeChunks[i];
+		}
+		tmpEdgeChunks.clear();
+		tmpEdges = tmpEdgeLast = tmpEdgeEnd = tmpEdgeFixedEnd = NULL;
 	}
+	// arcs declared in initSize but never added
+	a = arcs + 2*numEdges;
+	memset(a, 0, sizeof(Arc)*(arcEnd-a));
 
 	initNodes();
 }
@@ -832,6 +948,7 @@ template<bool dirS> void IBFSGraph::growth()
 	for (Node **active=active0.list; active != (active0.list + active0.len); active++)
 	{
 		// get active node
+		if (interruptDue()) return;
 		x = (*active);
 		testNode(x);
 
@@ -929,6 +1046,26 @@ template<bool sTree> void IBFSGraph::augmentIncrements()
 }
 
 
+unsigned long long IBFSGraph::computeCutCapacity()
+{
+	// the flow plus the residual capacity leaving the S tree
+	unsigned long long cut = flow;
+	Node *x;
+	Arc *a, *aEnd;
+	for (x=nodes; x != nodeEnd; x++) {
+		if (x->label <= 0) {
+			if (x->excess > 0) cut += x->excess;
+			continue;
+		}
+		if (x->excess < 0) cut -= x->excess;
+		aEnd = (x+1)->firstArc;
+		for (a=x->firstArc; a != aEnd; a++) {
+			if (a->rCap && a->head->label <= 0) cut += a->rCap;
+		}
+	}
+	return cut;
+}
+
 unsigned long long IBFSGraph::computeMaxFlow()
 {
 	return computeMaxFlow(true, false);
@@ -960,8 +1097,14 @@ unsigned long long IBFSGraph::computeMaxFlow(bool initialDirS, bool allowIncreme
 	// IBFS
 	//
 	bool dirS = initialDirS;
+	interrupted = false;
 	while (true)
 	{
+		if (interruptFunction != NULL) {
+			interruptCounter = IB_INTERRUPT_PERIOD;
+			if (interruptDue()) break;
+		}
+
 		// BFS level
 		if (dirS) {
 			ActiveList::swapLists(&active0, &activeS1);
@@ -975,6 +1118,7 @@ unsigned long long IBFSGraph::computeMaxFlow(bool initialDirS, bool allowIncreme
 		if (IB_EXCESSES) excessBuckets.allocate((topLevelS > topLevelT) ? topLevelS : topLevelT);
 		if (dirS) growth<true>();
 		else growth<false>();
+		if (interrupted) break;
 		if (IBTEST) {
 			testTree();
 			fprintf(stdout, "dirS=%d aug=%d   S %d / T %d   flow=%d\n",
@@ -992,6 +1136,9 @@ unsigned long long IBFSGraph::computeMaxFlow(bool initialDirS, bool allowIncreme
 		else if (IB_ALTERNATE_SMART && uniqOrphansT < uniqOrphansS) dirS=false;
 		else dirS=true;
 	}
+	// a closed T tree is the sink side of a minimum cut, a closed S tree or
+	// the S tree of an interrupted solve the source side
+	freeNodeSegment = (!interrupted && activeT1.len == 0) ? 0 : 1;
 
 	incIteration++;
 	return flow;
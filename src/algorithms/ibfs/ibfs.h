@@ -46,6 +46,7 @@ If you require another license, please contact the above.
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <vector>
 
 
 #define IB_BOTTLENECK_ORIG 0
@@ -57,6 +58,9 @@ If you require another license, please contact the above.
 #define IB_ALTERNATE_SMART 1
 #define IB_HYBRID_ADOPTION 1
 #define IB_EXCESSES 1
+#define IB_INTERRUPT_PERIOD 1024
+// edges per chunk added past the number given to initSize
+#define IB_EDGE_CHUNK (1<<16)
 #define IB_ALLOC_INIT_LEVELS 4096
 #define IB_ADOPTION_PR 0
 #define IB_DEBUG_INIT 0
@@ -170,6 +174,21 @@ public:
 	inline int getNumArcs() {
 		return arcEnd-arcs;
 	}
+	// interruptFunction(interruptData) is called every IB_INTERRUPT_PERIOD
+	// growth steps of computeMaxFlow, which stops once it returns true with a
+	// feasible flow and the cut of the current S tree
+	void setInterrupt(bool (*a_interruptFunction)(void *), void *a_interruptData) {
+		interruptFunction = a_interruptFunction;
+		interruptData = a_interruptData;
+		interruptCounter = 0;
+	}
+	inline bool isInterrupted() {
+		return interrupted;
+	}
+	// capacity of the cut of the S tree, linear in the size of the graph
+	unsigned long long computeCutCapacity();
+	// bytes held by the arc and list memory, nodes, buckets and edge chunks
+	unsigned long long memoryBytes() const;
 	int isNodeOnSrcSide(int nodeIndex, int freeNodeValue = 0);
   int what_segment(int nodeIndex);
 
@@ -516,8 +535,28 @@ private:
 		TmpArc		*rev;
 		int			cap;
 	};
+	bool (*interruptFunction)(void *);
+	void *interruptData;
+	int interruptCounter;
+	bool interrupted;
+	// segment of the nodes in neither tree, the sink unless the T tree is
+	// the one that stopped growing
+	int freeNodeSegment;
+	inline bool interruptDue() {
+		if (interruptFunction == NULL || ++interruptCounter < IB_INTERRUPT_PERIOD) return false;
+		interruptCounter = 0;
+		if ((*interruptFunction)(interruptData)) interrupted = true;
+		return interrupted;
+	}
 	char	*memArcs;
+	// allocated sizes, initSize reuses memArcs and nodes when large enough
+	unsigned long long memArcsSize;
+	int nodesSize;
 	TmpEdge	*tmpEdges, *tmpEdgeLast;
+	// tmpEdges has room up to tmpEdgeFixedEnd, edges past it go to chunks of
+	// IB_EDGE_CHUNK and tmpEdgeLast, tmpEdgeEnd then move to the last chunk
+	TmpEdge	*tmpEdgeEnd, *tmpEdgeFixedEnd;
+	std::vector<TmpEdge*> tmpEdgeChunks;
 	TmpArc	*tmpArcs;
 	bool isInitializedGraph() {
 		return memArcs != NULL;
@@ -525,6 +564,12 @@ private:
 	IBFSInitMode initMode;
 	void initGraphFast();
 	void initGraphCompact();
+	void initLists();
+	void addEdgeChunk();
+	void freeEdgeChunks();
+	long long numEdgesAdded();
+	char *reallocArcs(long long numEdges);
+	void copyEdges(TmpEdge *te, TmpEdge *teEnd);
 	void initNodes();
 
 	//
@@ -692,6 +737,7 @@ inline void IBFSGraph::incArc(Arc *a, int deltaCap)
 
 inline void IBFSGraph::addEdge(int nodeIndexFrom, int nodeIndexTo, int capacity, int reverseCapacity)
 {
+	if (tmpEdgeLast == tmpEdgeEnd) addEdgeChunk();
 	tmpEdgeLast->tail = nodeIndexFrom;
 	tmpEdgeLast->head = nodeIndexTo;
 	tmpEdgeLast->cap = capacity;
@@ -729,6 +775,7 @@ inline void IBFSGraph::incEdge(int nodeIndexFrom, int nodeIndexTo, int capacity,
 }
 
 inline int IBFSGraph::what_segment(int nodeIndex) {
+    if (nodes[nodeIndex].label == 0) return freeNodeSegment;
     return nodes[nodeIndex].label > 0 ? 0 : 1;
 }
 
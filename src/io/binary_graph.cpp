@@ -0,0 +1,172 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file binary_graph.cpp
+ *
+ * @brief A versioned binary graph format, loaded from a memory mapped file
+ * without parsing, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-12
+ *
+ */
+
+#include "binary_graph.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace maxflowlib {
+namespace io {
+
+const char BinaryGraphHeader::MAGIC[8] = {'M', 'F', 'L', 'G', 'R', 'A', 'P', 'H'};
+
+BinaryGraphWriter::BinaryGraphWriter(nodeid nnode, arcid narc)
+    : m_nnode(nnode), m_source_cap(nnode, 0), m_sink_cap(nnode, 0) {
+  m_arcs.reserve(narc);
+}
+
+int32_t BinaryGraphWriter::checked_cap(cap c) {
+  if (c < std::numeric_limits<int32_t>::min() ||
+      c > std::numeric_limits<int32_t>::max()) {
+    throw std::out_of_range("capacity does not fit a binary graph");
+  }
+  return int32_t(c);
+}
+
+void BinaryGraphWriter::add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+  if (s < 0 || s >= m_nnode || t < 0 || t >= m_nnode) {
+    throw std::out_of_range("arc node out of range for a binary graph");
+  }
+  input_arc a = {s, t, checked_cap(fcap), checked_cap(rcap)};
+  m_arcs.push_back(a);
+}
+
+void BinaryGraphWriter::set_tweights(nodeid s, cap scap, cap tcap) {
+  if (s < 0 || s >= m_nnode) {
+    throw std::out_of_range("node out of range for a binary graph");
+  }
+  m_source_cap[s] = checked_cap(m_source_cap[s] + scap);
+  m_sink_cap[s] = checked_cap(m_sink_cap[s] + tcap);
+}
+
+void BinaryGraphWriter::write(const std::string &filename) const {
+  BinaryGraphHeader header;
+  std::memcpy(header.magic, BinaryGraphHeader::MAGIC, sizeof(header.magic));
+  header.version = BinaryGraphHeader::VERSION;
+  header.byte_order = BinaryGraphHeader::ENDIAN_MARK;
+  header.nnode = uint64_t(m_nnode);
+  header.narc = m_arcs.size();
+
+  // counting sort of the arcs by source node, stable
+  std::vector<uint64_t> offsets(m_nnode + 1, 0);
+  for (const input_arc &a : m_arcs) {
+    offsets[a.s + 1]++;
+  }
+  for (int u = 0; u < m_nnode; ++u) {
+    offsets[u + 1] += offsets[u];
+  }
+  std::vector<int32_t> heads(m_arcs.size()), fcaps(m_arcs.size()),
+      rcaps(m_arcs.size());
+  std::vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+  for (const input_arc &a : m_arcs) {
+    const uint64_t k = next[a.s]++;
+    heads[k] = a.t;
+    fcaps[k] = a.fcap;
+    rcaps[k] = a.rcap;
+  }
+
+  std::unique_ptr<FILE, int (*)(FILE *)> stream(
+      std::fopen(filename.c_str(), "wb"), &std::fclose);
+  if (!stream) {
+    throw std::runtime_error("failed to open file for writing: " + filename);
+  }
+  auto put = [&](const void *data, size_t size) {
+    if (size && std::fwrite(data, 1, size, stream.get()) != size) {
+      throw std::runtime_error("failed to write binary graph: " + filename);
+    }
+  };
+  put(&header, sizeof(header));
+  put(offsets.data(), offsets.size() * sizeof(uint64_t));
+  put(heads.data(), heads.size() * sizeof(int32_t));
+  put(fcaps.data(), fcaps.size() * sizeof(int32_t));
+  put(rcaps.data(), rcaps.size() * sizeof(int32_t));
+  put(m_source_cap.data(), m_source_cap.size() * sizeof(int32_t));
+  put(m_sink_cap.data(), m_sink_cap.size() * sizeof(int32_t));
+  if (std::fclose(stream.release())) {
+    throw std::runtime_error("failed to write binary graph: " + filename);
+  }
+}
+
+BinaryGraphFile::BinaryGraphFile(const std::string &filename)
+    : m_filename(filename), m_file(filename) {
+  if (m_file.size() < sizeof(BinaryGraphHeader)) {
+    throw std::runtime_error("not a binary graph: " + filename);
+  }
+  m_header = reinterpret_cast<const BinaryGraphHeader *>(m_file.data());
+  if (std::memcmp(m_header->magic, BinaryGraphHeader::MAGIC,
+                  sizeof(m_header->magic))) {
+    throw std::runtime_error("not a binary graph: " + filename);
+  }
+  if (m_header->version != BinaryGraphHeader::VERSION) {
+    throw std::runtime_error("unsupported binary graph version " +
+                             std::to_string(m_header->version) + ": " +
+                             filename);
+  }
+  if (m_header->byte_order != BinaryGraphHeader::ENDIAN_MARK) {
+    throw std::runtime_error("binary graph of another byte order: " +
+                             filename);
+  }
+  if (m_header->nnode > uint64_t(std::numeric_limits<int>::max()) ||
+      m_header->file_size() != m_file.size()) {
+    throw std::runtime_error("truncated or corrupt binary graph: " + filename);
+  }
+  const uint64_t nnode = m_header->nnode, narc = m_header->narc;
+  m_offsets = reinterpret_cast<const uint64_t *>(m_header + 1);
+  m_heads = reinterpret_cast<const int32_t *>(m_offsets + nnode + 1);
+  m_fcaps = m_heads + narc;
+  m_rcaps = m_fcaps + narc;
+  m_source_caps = m_rcaps + narc;
+  m_sink_caps = m_source_caps + nnode;
+  // the offsets are read by every engine, checking them costs O(nnode)
+  for (uint64_t u = 0; u < nnode; ++u) {
+    if (m_offsets[u] > m_offsets[u + 1]) {
+      throw std::runtime_error("corrupt binary graph offsets: " + filename);
+    }
+  }
+  if (m_offsets[0] != 0 || m_offsets[nnode] != narc) {
+    throw std::runtime_error("corrupt binary graph offsets: " + filename);
+  }
+}
+
+bool BinaryGraphFile::is_binary_graph(const std::string &filename) {
+  char magic[sizeof(BinaryGraphHeader::MAGIC)];
+  FILE *stream = std::fopen(filename.c_str(), "rb");
+  if (!stream) {
+    return false;
+  }
+  const bool binary = std::fread(magic, 1, sizeof(magic), stream) ==
+                          sizeof(magic) &&
+                      !std::memcmp(magic, BinaryGraphHeader::MAGIC,
+                                   sizeof(magic));
+  std::fclose(stream);
+  return binary;
+}
+} // namespace io
+} // namespace maxflowlib
@@ -0,0 +1,227 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file binary_graph.h
+ *
+ * @brief A versioned binary graph format, loaded from a memory mapped file
+ * without parsing, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-12
+ *
+ */
+#ifndef MAXFLOWLIB_IO_BINARY_GRAPH_H
+#define MAXFLOWLIB_IO_BINARY_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "util/mapped_file.h"
+
+namespace maxflowlib {
+namespace io {
+
+/**
+ * @brief Header at the start of a binary graph file.
+ *
+ * The header is followed by the arrays, in native byte order:
+ *
+ *   uint64 offsets[nnode + 1]  arcs of node u are offsets[u]..offsets[u+1]-1
+ *   int32  heads[narc]         target node of every arc
+ *   int32  fcaps[narc]         forward capacities
+ *   int32  rcaps[narc]         reverse capacities
+ *   int32  source_caps[nnode]  capacities source -> node
+ *   int32  sink_caps[nnode]    capacities node -> sink
+ */
+struct BinaryGraphHeader {
+  char magic[8];
+  uint32_t version;
+  // ENDIAN_MARK as written, tells files of another endianness apart
+  uint32_t byte_order;
+  uint64_t nnode;
+  uint64_t narc;
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const uint32_t ENDIAN_MARK = 0x01020304;
+
+  /**
+   * @brief Size of a file with this header
+   */
+  uint64_t file_size() const {
+    return sizeof(BinaryGraphHeader) + 8 * (nnode + 1) + 12 * narc +
+           8 * nnode;
+  }
+};
+
+/**
+ * @brief Collects a graph and writes it in the binary format. It has the
+ * interface of a graph, so DimacsReader::read and anything else that builds
+ * graphs can fill it.
+ *
+ * Capacities must fit in 32 bits, the capacities of repeated set_tweights
+ * calls are summed.
+ */
+class BinaryGraphWriter {
+public:
+  typedef int nodeid;
+  typedef int arcid;
+  typedef long long cap;
+
+private:
+  struct input_arc {
+    int32_t s, t, fcap, rcap;
+  };
+
+  int m_nnode;
+  std::vector<input_arc> m_arcs;
+  std::vector<int32_t> m_source_cap;
+  std::vector<int32_t> m_sink_cap;
+
+  static int32_t checked_cap(cap c);
+
+public:
+  /**
+   * @brief BinaryGraphWriter class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph, a hint
+   */
+  BinaryGraphWriter(nodeid nnode, arcid narc);
+
+  /**
+   * @brief Adds an arc
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   *
+   * @throws std::out_of_range if a node or capacity does not fit the format
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap);
+
+  /**
+   * @brief Adds source and sink connection to node
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   *
+   * @throws std::out_of_range if the node or a capacity does not fit the format
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap);
+
+  /**
+   * @brief Writes the graph, arcs sorted by source node
+   *
+   * @param filename the binary graph file
+   *
+   * @throws std::runtime_error if the file can not be written
+   */
+  void write(const std::string &filename) const;
+};
+
+/**
+ * @brief A binary graph file mapped read-only. The arrays point straight into
+ * the mapping, nothing is parsed or copied until read() adds the arcs to an
+ * engine.
+ */
+class BinaryGraphFile {
+
+private:
+  std::string m_filename;
+  util::MappedFile m_file;
+  const BinaryGraphHeader *m_header;
+  const uint64_t *m_offsets;
+  const int32_t *m_heads;
+  const int32_t *m_fcaps;
+  const int32_t *m_rcaps;
+  const int32_t *m_source_caps;
+  const int32_t *m_sink_caps;
+
+public:
+  /**
+   * @brief Maps the file and checks its header and size
+   *
+   * @param filename the binary graph file
+   *
+   * @throws std::runtime_error if the file can not be mapped or is not a
+   * binary graph of this version and byte order
+   */
+  explicit BinaryGraphFile(const std::string &filename);
+
+  /**
+   * @brief Whether a file starts like a binary graph file
+   */
+  static bool is_binary_graph(const std::string &filename);
+
+  int nnode() const { return int(m_header->nnode); }
+
+  size_t narc() const { return size_t(m_header->narc); }
+
+  const uint64_t *offsets() const { return m_offsets; }
+  const int32_t *heads() const { return m_heads; }
+  const int32_t *fcaps() const { return m_fcaps; }
+  const int32_t *rcaps() const { return m_rcaps; }
+  const int32_t *source_caps() const { return m_source_caps; }
+  const int32_t *sink_caps() const { return m_sink_caps; }
+
+  /**
+   * @brief Adds the arcs of the file to a graph of nnode() nodes
+   *
+   * @param g the graph
+   *
+   * @throws std::runtime_error if an arc points outside the graph
+   */
+  template <typename Graph> void read(Graph &g) const {
+    typedef typename Graph::cap cap;
+    const int n = nnode();
+    for (int u = 0; u < n; ++u) {
+      for (uint64_t k = m_offsets[u]; k < m_offsets[u + 1]; ++k) {
+        if (m_heads[k] < 0 || m_heads[k] >= n) {
+          throw std::runtime_error("arc head out of range in binary graph: " +
+                                   m_filename);
+        }
+        g.add_arc(u, m_heads[k], cap(m_fcaps[k]), cap(m_rcaps[k]));
+      }
+    }
+    for (int u = 0; u < n; ++u) {
+      if (m_source_caps[u] > 0 || m_sink_caps[u] > 0) {
+        g.set_tweights(u, cap(m_source_caps[u]), cap(m_sink_caps[u]));
+      }
+    }
+  }
+
+  /**
+   * @brief Allocates a graph and reads the file into it
+   *
+   * @return a pointer to an allocated Graph
+   */
+  template <typename Graph> Graph *create() const {
+    Graph *g = new Graph(nnode(), int(narc()));
+    read(*g);
+    return g;
+  }
+};
+} // namespace io
+} // namespace maxflowlib
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file compressed_graph.cpp
+ *
+ * @brief A compressed graph format, delta and varint encoded adjacency lists
+ * decoded in blocks, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-12
+ *
+ */
+
+#include "compressed_graph.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <tuple>
+
+namespace maxflowlib {
+namespace io {
+
+const char CompressedGraphHeader::MAGIC[8] = {'M', 'F', 'L', 'G',
+                                              'R', 'A', 'P', 'Z'};
+
+namespace {
+
+void put_varint(std::vector<uint8_t> &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(uint8_t(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(uint8_t(v));
+}
+
+uint64_t zigzag(long long v) {
+  return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+long long unzigzag(uint64_t v) {
+  return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+/**
+ * @brief Decodes a varint, advancing p past it
+ *
+ * @return false if it runs past end or over 64 bits
+ */
+inline bool get_varint(const uint8_t *&p, const uint8_t *end, uint64_t &v) {
+  v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (p == end) {
+      return false;
+    }
+    const uint8_t byte = *p++;
+    v |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+CompressedGraphWriter::CompressedGraphWriter(nodeid nnode, arcid narc,
+                                             int block_nodes)
+    : m_nnode(nnode), m_block_nodes(std::max(block_nodes, 1)),
+      m_source_cap(nnode, 0), m_sink_cap(nnode, 0) {
+  m_arcs.reserve(narc);
+}
+
+void CompressedGraphWriter::add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+  if (s < 0 || s >= m_nnode || t < 0 || t >= m_nnode) {
+    throw std::out_of_range("arc node out of range for a compressed graph");
+  }
+  if (fcap < 0 || rcap < 0 || fcap > std::numeric_limits<cap>::max() / 2) {
+    throw std::out_of_range("capacity does not fit a compressed graph");
+  }
+  input_arc a = {s, t, fcap, rcap};
+  m_arcs.push_back(a);
+}
+
+void CompressedGraphWriter::set_tweights(nodeid s, cap scap, cap tcap) {
+  if (s < 0 || s >= m_nnode) {
+    throw std::out_of_range("node out of range for a compressed graph");
+  }
+  if (scap < 0 || tcap < 0) {
+    throw std::out_of_range("capacity does not fit a compressed graph");
+  }
+  m_source_cap[s] += scap;
+  m_sink_cap[s] += tcap;
+}
+
+void CompressedGraphWriter::write(const std::string &filename) const {
+  std::vector<input_arc> arcs(m_arcs);
+  std::sort(arcs.begin(), arcs.end(),
+            [](const input_arc &a, const input_arc &b) {
+              return std::tie(a.s, a.t, a.fcap, a.rcap) <
+                     std::tie(b.s, b.t, b.fcap, b.rcap);
+            });
+
+  CompressedGraphHeader header;
+  std::memcpy(header.magic, CompressedGraphHeader::MAGIC,
+              sizeof(header.magic));
+  header.version = CompressedGraphHeader::VERSION;
+  header.endian_mark = CompressedGraphHeader::ENDIAN_MARK;
+  header.nnode = uint64_t(m_nnode);
+  header.narc = arcs.size();
+  header.block_nodes = uint64_t(m_block_nodes);
+  header.nblock = (header.nnode + header.block_nodes - 1) / header.block_nodes;
+
+  std::vector<uint64_t> block_bytes(1, 0), block_arcs(1, 0);
+  std::vector<uint8_t> data;
+  data.reserve(3 * arcs.size() + 3 * size_t(m_nnode));
+  size_t k = 0;
+  for (int u = 0; u < m_nnode; ++u) {
+    size_t end = k;
+    while (end < arcs.size() && arcs[end].s == u) {
+      ++end;
+    }
+    put_varint(data, end - k);
+    put_varint(data, uint64_t(m_source_cap[u]));
+    put_varint(data, uint64_t(m_sink_cap[u]));
+    long long previous = u;
+    for (size_t i = k; i < end; ++i) {
+      const input_arc &a = arcs[i];
+      const long long delta = (long long)a.t - previous;
+      // only the first head can lie before the previous one
+      put_varint(data, i == k ? zigzag(delta) : uint64_t(delta));
+      previous = a.t;
+      put_varint(data, 2 * uint64_t(a.fcap) + (a.rcap != 0));
+      if (a.rcap != 0) {
+        put_varint(data, uint64_t(a.rcap));
+      }
+    }
+    k = end;
+    if ((u + 1) % m_block_nodes == 0 || u + 1 == m_nnode) {
+      block_bytes.push_back(data.size());
+      block_arcs.push_back(k);
+    }
+  }
+
+  std::unique_ptr<FILE, int (*)(FILE *)> stream(
+      std::fopen(filename.c_str(), "wb"), &std::fclose);
+  if (!stream) {
+    throw std::runtime_error("failed to open file for writing: " + filename);
+  }
+  auto put = [&](const void *bytes, size_t size) {
+    if (size && std::fwrite(bytes, 1, size, stream.get()) != size) {
+      throw std::runtime_error("failed to write compressed graph: " +
+                               filename);
+    }
+  };
+  put(&header, sizeof(header));
+  put(block_bytes.data(), block_bytes.size() * sizeof(uint64_t));
+  put(block_arcs.data(), block_arcs.size() * sizeof(uint64_t));
+  put(data.data(), data.size());
+  if (std::fclose(stream.release())) {
+    throw std::runtime_error("failed to write compressed graph: " + filename);
+  }
+}
+
+CompressedGraphFile::CompressedGraphFile(const std::string &filename)
+    : m_filename(filename), m_file(filename) {
+  if (m_file.size() < sizeof(CompressedGraphHeader)) {
+    throw std::runtime_error("not a compressed graph: " + filename);
+  }
+  m_header = reinterpret_cast<const CompressedGraphHeader *>(m_file.data());
+  if (std::memcmp(m_header->magic, CompressedGraphHeader::MAGIC,
+                  sizeof(m_header->magic))) {
+    throw std::runtime_error("not a compressed graph: " + filename);
+  }
+  if (m_header->version != CompressedGraphHeader::VERSION) {
+    throw std::runtime_error("unsupported compressed graph version " +
+                             std::to_string(m_header->version) + ": " +
+                             filename);
+  }
+  if (m_header->endian_mark != CompressedGraphHeader::ENDIAN_MARK) {
+    throw std::runtime_error("compressed graph of another byte order: " +
+                             filename);
+  }
+  const uint64_t nblock = m_header->nblock;
+  if (m_header->nnode > uint64_t(std::numeric_limits<int>::max()) ||
+      m_header->block_nodes == 0 ||
+      nblock != (m_header->nnode + m_header->block_nodes - 1) /
+                    m_header->block_nodes ||
+      (m_file.size() - sizeof(CompressedGraphHeader)) / 16 < nblock + 1) {
+    throw std::runtime_error("truncated or corrupt compressed graph: " +
+                             filename);
+  }
+  m_block_bytes = reinterpret_cast<const uint64_t *>(m_header + 1);
+  m_block_arcs = m_block_bytes + nblock + 1;
+  m_data = reinterpret_cast<const uint8_t *>(m_block_arcs + nblock + 1);
+  const uint64_t data_size =
+      m_file.size() - sizeof(CompressedGraphHeader) - 16 * (nblock + 1);
+  for (uint64_t b = 0; b < nblock; ++b) {
+    if (m_block_bytes[b] > m_block_bytes[b + 1] ||
+        m_block_arcs[b] > m_block_arcs[b + 1]) {
+      throw std::runtime_error("corrupt compressed graph index: " + filename);
+    }
+  }
+  if (m_block_bytes[0] != 0 || m_block_bytes[nblock] != data_size ||
+      m_block_arcs[0] != 0 || m_block_arcs[nblock] != m_header->narc) {
+    throw std::runtime_error("truncated or corrupt compressed graph: " +
+                             filename);
+  }
+}
+
+bool CompressedGraphFile::is_compressed_graph(const std::string &filename) {
+  char magic[sizeof(CompressedGraphHeader::MAGIC)];
+  FILE *stream = std::fopen(filename.c_str(), "rb");
+  if (!stream) {
+    return false;
+  }
+  const bool compressed = std::fread(magic, 1, sizeof(magic), stream) ==
+                              sizeof(magic) &&
+                          !std::memcmp(magic, CompressedGraphHeader::MAGIC,
+                                       sizeof(magic));
+  std::fclose(stream);
+  return compressed;
+}
+
+void CompressedGraphFile::decode_block(size_t b, decoded_block &block) const {
+  const size_t narc = size_t(m_block_arcs[b + 1] - m_block_arcs[b]);
+  block.s.resize(narc);
+  block.t.resize(narc);
+  block.fcap.resize(narc);
+  block.rcap.resize(narc);
+  block.terminal.clear();
+  block.scap.clear();
+  block.tcap.clear();
+  block.error.clear();
+  const uint8_t *p = m_data + m_block_bytes[b];
+  const uint8_t *end = m_data + m_block_bytes[b + 1];
+  const long long n = (long long)m_header->nnode;
+  const long long first = (long long)(b * m_header->block_nodes);
+  const long long last = std::min(first + (long long)m_header->block_nodes, n);
+  size_t k = 0;
+  for (long long u = first; u < last; ++u) {
+    uint64_t degree, scap, tcap;
+    if (!get_varint(p, end, degree) || !get_varint(p, end, scap) ||
+        !get_varint(p, end, tcap) || degree > narc - k) {
+      block.error = "corrupt node";
+      return;
+    }
+    if (scap || tcap) {
+      block.terminal.push_back(int(u));
+      block.scap.push_back((long long)scap);
+      block.tcap.push_back((long long)tcap);
+    }
+    long long t = u;
+    for (uint64_t i = 0; i < degree; ++i, ++k) {
+      uint64_t delta, caps, rcap = 0;
+      if (!get_varint(p, end, delta) || !get_varint(p, end, caps) ||
+          ((caps & 1) && !get_varint(p, end, rcap))) {
+        block.error = "corrupt arc";
+        return;
+      }
+      t += i == 0 ? unzigzag(delta) : (long long)delta;
+      if (t < 0 || t >= n) {
+        block.error = "arc head out of range";
+        return;
+      }
+      block.s[k] = int(u);
+      block.t[k] = int(t);
+      block.fcap[k] = (long long)(caps >> 1);
+      block.rcap[k] = (long long)rcap;
+    }
+  }
+  if (k != narc || p != end) {
+    block.error = "block size mismatch";
+  }
+}
+} // namespace io
+} // namespace maxflowlib
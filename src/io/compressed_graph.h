@@ -0,0 +1,274 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file compressed_graph.h
+ *
+ * @brief A compressed graph format, delta and varint encoded adjacency lists
+ * decoded in blocks, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-12
+ *
+ */
+#ifndef MAXFLOWLIB_IO_COMPRESSED_GRAPH_H
+#define MAXFLOWLIB_IO_COMPRESSED_GRAPH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "util/mapped_file.h"
+#include "util/thread_pool.h"
+
+namespace maxflowlib {
+namespace io {
+
+/**
+ * @brief Header at the start of a compressed graph file.
+ *
+ * The header is followed by two block indices, in native byte order, and
+ * the encoded blocks:
+ *
+ *   uint64 block_bytes[nblock + 1]  block b is data[block_bytes[b]..]
+ *   uint64 block_arcs[nblock + 1]   arcs before block b
+ *   uint8  data[block_bytes[nblock]]
+ *
+ * Block b holds nodes b * block_nodes onwards. Every node is written as
+ * varints: its degree, its source and sink capacities, then its arcs sorted
+ * by head. A head is the zigzag delta to the node for the first arc and the
+ * delta to the previous head after that. The capacities of an arc are
+ * 2 * fcap + (rcap != 0) followed by rcap if it is not 0, so the common arc
+ * with a small forward capacity and no reverse capacity takes one byte.
+ */
+struct CompressedGraphHeader {
+  char magic[8];
+  uint32_t version;
+  // ENDIAN_MARK as written, tells files of another endianness apart
+  uint32_t endian_mark;
+  uint64_t nnode;
+  uint64_t narc;
+  uint64_t nblock;
+  uint64_t block_nodes;
+
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const uint32_t ENDIAN_MARK = 0x01020304;
+};
+
+/**
+ * @brief Collects a graph and writes it in the compressed format. It has the
+ * interface of a graph, so DimacsReader::read and anything else that builds
+ * graphs can fill it.
+ *
+ * Capacities must not be negative, the capacities of repeated set_tweights
+ * calls are summed.
+ */
+class CompressedGraphWriter {
+public:
+  typedef int nodeid;
+  typedef int arcid;
+  typedef long long cap;
+
+  // nodes per block, the unit of decoding
+  static const int DEFAULT_BLOCK_NODES = 1 << 12;
+
+private:
+  struct input_arc {
+    int s, t;
+    long long fcap, rcap;
+  };
+
+  int m_nnode;
+  int m_block_nodes;
+  std::vector<input_arc> m_arcs;
+  std::vector<long long> m_source_cap;
+  std::vector<long long> m_sink_cap;
+
+public:
+  /**
+   * @brief CompressedGraphWriter class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph, a hint
+   * @param block_nodes nodes per block
+   */
+  CompressedGraphWriter(nodeid nnode, arcid narc,
+                        int block_nodes = DEFAULT_BLOCK_NODES);
+
+  /**
+   * @brief Adds an arc
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   *
+   * @throws std::out_of_range for a node outside the graph or a negative
+   * capacity
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap);
+
+  /**
+   * @brief Adds source and sink connection to node
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   *
+   * @throws std::out_of_range for a node outside the graph or a negative
+   * capacity
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap);
+
+  /**
+   * @brief Encodes and writes the graph
+   *
+   * @param filename the compressed graph file
+   *
+   * @throws std::runtime_error if the file can not be written
+   */
+  void write(const std::string &filename) const;
+};
+
+/**
+ * @brief A compressed graph file mapped read-only and decoded block by block
+ * into a graph.
+ *
+ * read() decodes a wave of blocks, adds their arcs to the graph and moves
+ * on, so only a wave is ever held decoded. With several threads the blocks
+ * of a wave are decoded in parallel, the arcs are still added by one thread
+ * and in file order.
+ */
+class CompressedGraphFile {
+
+private:
+  // blocks decoded per thread in a wave
+  static const size_t BLOCKS_PER_THREAD = 4;
+
+  struct decoded_block {
+    std::vector<int> s, t;
+    std::vector<long long> fcap, rcap;
+    // nodes with source or sink capacity
+    std::vector<int> terminal;
+    std::vector<long long> scap, tcap;
+    std::string error;
+  };
+
+  std::string m_filename;
+  util::MappedFile m_file;
+  const CompressedGraphHeader *m_header;
+  const uint64_t *m_block_bytes;
+  const uint64_t *m_block_arcs;
+  const uint8_t *m_data;
+
+  void decode_block(size_t b, decoded_block &block) const;
+
+public:
+  /**
+   * @brief Maps the file and checks its header and block index
+   *
+   * @param filename the compressed graph file
+   *
+   * @throws std::runtime_error if the file can not be mapped or is not a
+   * compressed graph of this version and byte order
+   */
+  explicit CompressedGraphFile(const std::string &filename);
+
+  /**
+   * @brief Whether a file starts like a compressed graph file
+   */
+  static bool is_compressed_graph(const std::string &filename);
+
+  int nnode() const { return int(m_header->nnode); }
+
+  size_t narc() const { return size_t(m_header->narc); }
+
+  size_t nblock() const { return size_t(m_header->nblock); }
+
+  /**
+   * @brief Decodes the file into a graph of nnode() nodes
+   *
+   * @param g the graph
+   * @param num_threads threads decoding blocks, 0 uses the hardware
+   * concurrency
+   *
+   * @throws std::runtime_error if a block is corrupt
+   */
+  template <typename Graph> void read(Graph &g, unsigned num_threads = 1) const {
+    typedef typename Graph::cap cap;
+    std::unique_ptr<util::ThreadPool> pool;
+    if (num_threads != 1 && nblock() > 1) {
+      pool.reset(new util::ThreadPool(num_threads));
+    }
+    const size_t wave = pool ? pool->size() * BLOCKS_PER_THREAD : 1;
+    std::vector<decoded_block> blocks(std::min(wave, nblock()));
+    // set after all arcs, as every reader does
+    std::vector<int> terminal;
+    std::vector<long long> scap, tcap;
+    for (size_t first = 0; first < nblock(); first += wave) {
+      const size_t last = std::min(first + wave, nblock());
+      auto decode = [&](size_t b, unsigned) {
+        decode_block(b, blocks[b - first]);
+      };
+      if (pool) {
+        pool->parallel_for(first, last, 1, decode);
+      } else {
+        for (size_t b = first; b < last; ++b) {
+          decode(b, 0);
+        }
+      }
+      for (size_t b = first; b < last; ++b) {
+        const decoded_block &block = blocks[b - first];
+        if (!block.error.empty()) {
+          throw std::runtime_error(block.error + " in compressed graph: " +
+                                   m_filename + ", block " +
+                                   std::to_string(b));
+        }
+        for (size_t k = 0; k < block.s.size(); ++k) {
+          g.add_arc(block.s[k], block.t[k], cap(block.fcap[k]),
+                    cap(block.rcap[k]));
+        }
+        terminal.insert(terminal.end(), block.terminal.begin(),
+                        block.terminal.end());
+        scap.insert(scap.end(), block.scap.begin(), block.scap.end());
+        tcap.insert(tcap.end(), block.tcap.begin(), block.tcap.end());
+      }
+    }
+    for (size_t k = 0; k < terminal.size(); ++k) {
+      g.set_tweights(terminal[k], cap(scap[k]), cap(tcap[k]));
+    }
+  }
+
+  /**
+   * @brief Allocates a graph and decodes the file into it
+   *
+   * @return a pointer to an allocated Graph
+   */
+  template <typename Graph> Graph *create(unsigned num_threads = 1) const {
+    Graph *g = new Graph(nnode(), int(narc()));
+    read(*g, num_threads);
+    return g;
+  }
+};
+} // namespace io
+} // namespace maxflowlib
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file dimacs_reader.cpp
+ *
+ * @brief Reads DIMACS maxflow files from a memory mapped file straight into
+ * any graph, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-11
+ *
+ */
+
+#include "dimacs_reader.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace maxflowlib {
+namespace io {
+
+namespace {
+
+/**
+ * @brief Checks an 'n' line, the source must be node 1 and the sink node 2
+ *
+ * @return an error message, empty if the line is fine
+ */
+std::string check_node_line(const char *q, const char *eol, bool &has_source,
+                            bool &has_sink) {
+  long long s;
+  if (!detail::parse_int(q, eol, s)) {
+    return "'n' line is malformed";
+  }
+  while (q < eol && (*q == ' ' || *q == '\t')) {
+    ++q;
+  }
+  if (q < eol && *q == 's') {
+    if (s != 1) {
+      return "'n' line specified source as something else than 1, "
+             "currently unsupported";
+    }
+    has_source = true;
+  } else if (q < eol && *q == 't') {
+    if (s != 2) {
+      return "'n' line specified sink as something else than 2, "
+             "currently unsupported";
+    }
+    has_sink = true;
+  } else {
+    return "'n' line is malformed";
+  }
+  return std::string();
+}
+} // namespace
+
+DimacsReader::DimacsReader(const std::string &filename, unsigned num_threads)
+    : m_filename(filename), m_file(filename), m_nnode(-1), m_narc(0),
+      m_nterminal_arc(0), m_header_lines(0) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  split(scan_header(), num_threads);
+  if (m_chunks.size() > 1) {
+    m_pool.reset(new util::ThreadPool(num_threads));
+    m_pool->parallel_for(0, m_chunks.size(), 1, [this](size_t k, unsigned) {
+      scan_chunk(m_chunks[k]);
+    });
+  } else if (!m_chunks.empty()) {
+    scan_chunk(m_chunks[0]);
+  }
+  size_t line = m_header_lines;
+  for (chunk &c : m_chunks) {
+    if (!c.error.empty()) {
+      // c.lines stopped at the failing line
+      throw std::runtime_error(c.error + " in DIMACS file: " + m_filename +
+                               ", line " + std::to_string(line + c.lines));
+    }
+    c.offset = m_narc + m_nterminal_arc;
+    line += c.lines;
+    m_narc += c.narc - c.nterminal_arc;
+    m_nterminal_arc += c.nterminal_arc;
+  }
+}
+
+size_t DimacsReader::scan_header() {
+  const char *begin = m_file.data(), *p = begin, *end = p + m_file.size();
+  bool has_source = false, has_sink = false;
+  auto fail = [&](const std::string &what) {
+    throw std::runtime_error(what + " in DIMACS file: " + m_filename +
+                             ", line " + std::to_string(m_header_lines));
+  };
+  while (p < end && *p != 'a') {
+    const char *eol = detail::line_end(p, end);
+    const char *q = p + 1;
+    long long n, m;
+    ++m_header_lines;
+    if (*p == 'p') {
+      // skip the problem type
+      while (q < eol && (*q == ' ' || *q == '\t')) {
+        ++q;
+      }
+      while (q < eol && *q != ' ' && *q != '\t') {
+        ++q;
+      }
+      if (m_nnode >= 0) {
+        fail("repeated p line");
+      }
+      if (!detail::parse_int(q, eol, n) || !detail::parse_int(q, eol, m) ||
+          n < 2) {
+        fail("p line is malformed");
+      }
+      m_nnode = n;
+    } else if (*p == 'n') {
+      std::string error = check_node_line(q, eol, has_source, has_sink);
+      if (!error.empty()) {
+        fail(error);
+      }
+    }
+    // comments and blank lines are skipped
+    p = eol + 1;
+  }
+  if (m_nnode < 0) {
+    fail("missing p line");
+  }
+  if (!has_source || !has_sink) {
+    fail("missing source or sink 'n' line");
+  }
+  return size_t(std::min(p, end) - begin);
+}
+
+void DimacsReader::split(size_t body, unsigned num_threads) {
+  const char *data = m_file.data();
+  const size_t size = m_file.size();
+  size_t nchunk = 1;
+  if (num_threads > 1) {
+    nchunk = std::max((size - body) / CHUNK_BYTES, size_t(1));
+  }
+  const size_t step = (size - body) / nchunk;
+  size_t begin = body;
+  while (begin < size) {
+    size_t end = std::min(begin + step, size);
+    if (end < size) {
+      end = size_t(detail::line_end(data + end, data + size) - data) + 1;
+      end = std::min(end, size);
+    }
+    chunk c = {begin, end, 0, 0, 0, 0, std::string()};
+    m_chunks.push_back(c);
+    begin = end;
+  }
+}
+
+void DimacsReader::scan_chunk(chunk &c) const {
+  const char *p = m_file.data() + c.begin, *end = m_file.data() + c.end;
+  bool has_source = false, has_sink = false;
+  while (p < end) {
+    const char *eol = detail::line_end(p, end);
+    const char *q = p + 1;
+    long long s, t, cap;
+    ++c.lines;
+    switch (*p) {
+    case 'p':
+      c.error = "repeated p line";
+      return;
+    case 'n':
+      c.error = check_node_line(q, eol, has_source, has_sink);
+      if (!c.error.empty()) {
+        return;
+      }
+      break;
+    case 'a':
+      if (!detail::parse_int(q, eol, s) || !detail::parse_int(q, eol, t) ||
+          !detail::parse_int(q, eol, cap)) {
+        c.error = "'a' line is malformed";
+        return;
+      }
+      if (s < 1 || s > m_nnode || t < 1 || t > m_nnode) {
+        c.error = "'a' line node out of range";
+        return;
+      }
+      if (t == SOURCE || s == SINK || (s == SOURCE && t == SINK)) {
+        c.error =
+            "specified source or sink as target or source node incorrectly";
+        return;
+      }
+      if (cap > 0) {
+        c.narc++;
+        if (s == SOURCE || t == SINK) {
+          c.nterminal_arc++;
+        }
+      }
+      break;
+    default:
+      // comments and blank lines
+      break;
+    }
+    p = eol + 1;
+  }
+}
+} // namespace io
+} // namespace maxflowlib
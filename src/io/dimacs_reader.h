@@ -0,0 +1,264 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file dimacs_reader.h
+ *
+ * @brief Reads DIMACS maxflow files from a memory mapped file straight into
+ * any graph, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-11
+ *
+ */
+#ifndef MAXFLOWLIB_IO_DIMACS_READER_H
+#define MAXFLOWLIB_IO_DIMACS_READER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/mapped_file.h"
+#include "util/thread_pool.h"
+
+namespace maxflowlib {
+namespace io {
+
+namespace detail {
+
+/**
+ * @brief End of the line starting at p, memchr scans a word at a time
+ */
+inline const char *line_end(const char *p, const char *end) {
+  const void *eol = std::memchr(p, '\n', size_t(end - p));
+  return eol ? static_cast<const char *>(eol) : end;
+}
+
+/**
+ * @brief Parses the next integer of a line, advancing p past it
+ *
+ * @return false if there is none, value is then 0
+ */
+inline bool parse_int(const char *&p, const char *end, long long &value) {
+  value = 0;
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    ++p;
+  }
+  bool negative = p < end && *p == '-';
+  if (negative) {
+    ++p;
+  }
+  if (p == end || unsigned(*p - '0') > 9) {
+    return false;
+  }
+  long long v = 0;
+  do {
+    v = 10 * v + (*p++ - '0');
+  } while (p < end && unsigned(*p - '0') <= 9);
+  value = negative ? -v : v;
+  return true;
+}
+
+/**
+ * @brief Parses the arc on an 'a' line already checked by DimacsReader
+ */
+inline void parse_arc(const char *p, const char *end, long long &s,
+                      long long &t, long long &cap) {
+  ++p;
+  parse_int(p, end, s);
+  parse_int(p, end, t);
+  parse_int(p, end, cap);
+}
+} // namespace detail
+
+/**
+ * @brief Reads a DIMACS maxflow file in two passes over a memory mapped copy:
+ * the constructor checks the file and counts the arcs, read() then adds them
+ * to a graph.
+ *
+ * The header, up to the first 'a' line, is read by one thread. The arc lines
+ * after it are cut at line boundaries into chunks which both passes parse in
+ * parallel. Read by one thread, arcs go straight into the graph. Read by
+ * several threads, a wave of chunks parses its arcs into a packed buffer at
+ * the offsets their counts give, the buffer is added in file order and the
+ * next wave reuses it, so the graph is the same either way and only a wave
+ * of arcs is ever held. The engines can only be filled by one thread.
+ *
+ * As in the examples the source must be node 1 and the sink node 2, the
+ * other nodes are numbered from 0 in the graph. Arcs without capacity are
+ * skipped and the capacities of source and sink arcs are summed per node.
+ */
+class DimacsReader {
+
+private:
+  static const long long SOURCE = 1;
+  static const long long SINK = 2;
+  // bytes of arc lines per chunk when read by several threads
+  static const size_t CHUNK_BYTES = 1 << 20;
+  // chunks per thread in a wave, so threads on slow chunks are caught up
+  static const size_t CHUNKS_PER_THREAD = 4;
+
+  struct chunk {
+    size_t begin, end;
+    // lines, arcs with capacity and how many of them are terminal
+    size_t lines;
+    size_t narc;
+    size_t nterminal_arc;
+    // index of the first arc among all arcs of the file
+    size_t offset;
+    std::string error;
+  };
+
+  template <typename cap> struct parsed_arc {
+    int s, t;
+    cap c;
+  };
+
+  std::string m_filename;
+  util::MappedFile m_file;
+  long long m_nnode;
+  size_t m_narc;
+  size_t m_nterminal_arc;
+  size_t m_header_lines;
+  std::vector<chunk> m_chunks;
+  std::unique_ptr<util::ThreadPool> m_pool;
+
+  size_t scan_header();
+  void split(size_t body, unsigned num_threads);
+  void scan_chunk(chunk &c) const;
+
+  /**
+   * @brief Calls visit(s, t, cap) for every arc with capacity of a chunk
+   */
+  template <typename Visitor>
+  void parse_chunk(const chunk &c, Visitor visit) const {
+    const char *p = m_file.data() + c.begin, *end = m_file.data() + c.end;
+    while (p < end) {
+      const char *eol = detail::line_end(p, end);
+      if (*p == 'a') {
+        long long s, t, cap;
+        detail::parse_arc(p, eol, s, t, cap);
+        if (cap > 0) {
+          visit(s, t, cap);
+        }
+      }
+      p = eol + 1;
+    }
+  }
+
+public:
+  /**
+   * @brief Maps the file and checks it
+   *
+   * @param filename the DIMACS file
+   * @param num_threads threads parsing the file, 0 uses the hardware
+   * concurrency
+   *
+   * @throws std::runtime_error if the file can not be read or is malformed
+   */
+  explicit DimacsReader(const std::string &filename, unsigned num_threads = 1);
+
+  /**
+   * @brief Number of nodes of the graph, without source and sink
+   */
+  int nnode() const { return int(m_nnode - 2); }
+
+  /**
+   * @brief Number of arcs between nodes of the graph
+   */
+  size_t narc() const { return m_narc; }
+
+  /**
+   * @brief Number of source and sink arcs
+   */
+  size_t nterminal_arc() const { return m_nterminal_arc; }
+
+  /**
+   * @brief Number of chunks the arc lines were cut into
+   */
+  size_t nchunk() const { return m_chunks.size(); }
+
+  /**
+   * @brief Adds the arcs of the file to a graph of nnode() nodes
+   *
+   * @param g the graph
+   */
+  template <typename Graph> void read(Graph &g) const {
+    typedef typename Graph::cap cap;
+    std::vector<cap> source_cap(nnode(), 0), sink_cap(nnode(), 0);
+    auto add = [&](long long s, long long t, cap c) {
+      if (s == SOURCE) {
+        source_cap[t - 3] += c;
+      } else if (t == SINK) {
+        sink_cap[s - 3] += c;
+      } else {
+        g.add_arc(int(s - 3), int(t - 3), c, 0);
+      }
+    };
+    if (m_pool && m_chunks.size() > 1) {
+      const size_t wave = m_pool->size() * CHUNKS_PER_THREAD;
+      std::vector<parsed_arc<cap> > arcs;
+      for (size_t first = 0; first < m_chunks.size(); first += wave) {
+        const size_t last = std::min(first + wave, m_chunks.size());
+        const size_t base = m_chunks[first].offset;
+        const size_t end = last < m_chunks.size() ? m_chunks[last].offset
+                                                  : m_narc + m_nterminal_arc;
+        arcs.resize(end - base);
+        m_pool->parallel_for(first, last, 1, [&](size_t k, unsigned) {
+          parsed_arc<cap> *a = arcs.data() + m_chunks[k].offset - base;
+          parse_chunk(m_chunks[k], [&](long long s, long long t, long long c) {
+            a->s = int(s);
+            a->t = int(t);
+            a->c = cap(c);
+            ++a;
+          });
+        });
+        for (const parsed_arc<cap> &a : arcs) {
+          add(a.s, a.t, a.c);
+        }
+      }
+    } else {
+      for (const chunk &k : m_chunks) {
+        parse_chunk(k, [&](long long s, long long t, long long c) {
+          add(s, t, cap(c));
+        });
+      }
+    }
+    for (int u = 0; u < nnode(); ++u) {
+      if (source_cap[u] > 0 || sink_cap[u] > 0) {
+        g.set_tweights(u, source_cap[u], sink_cap[u]);
+      }
+    }
+  }
+
+  /**
+   * @brief Allocates a graph and reads the file into it
+   *
+   * @return a pointer to an allocated Graph
+   */
+  template <typename Graph> Graph *create() const {
+    Graph *g = new Graph(nnode(), int(narc()));
+    read(*g);
+    return g;
+  }
+};
+} // namespace io
+} // namespace maxflowlib
+
+#endif
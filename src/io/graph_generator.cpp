@@ -0,0 +1,246 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file graph_generator.cpp
+ *
+ * @brief Generates the standard synthetic maxflow benchmark families straight
+ * into any graph, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-15
+ *
+ */
+
+#include "graph_generator.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace maxflowlib {
+namespace io {
+
+namespace {
+
+const int NUM_BLOBS = 6;
+// streams of the random generators, past those of the nodes and terminals
+const uint64_t BLOB_STREAM = ~uint64_t(0);
+
+int rounded_root(long long n, double power) {
+  return std::max(2, int(std::pow(double(n), power) + 0.5));
+}
+} // namespace
+
+const char *const GraphGenerator::FAMILY_NAMES[NFAMILY] = {
+    "grid2d", "grid3d",  "rlg_wide", "rlg_long",
+    "ak",     "layered", "matching", "genrmf"};
+
+GraphGenerator::GraphGenerator(Family family, long long nodes, uint64_t seed,
+                               int max_cap, int degree)
+    : m_family(family), m_seed(seed), m_max_cap(max_cap), m_degree(degree),
+      m_nnode(0), m_narc(0), m_frame_cap(0) {
+  if (nodes < 2) {
+    throw std::invalid_argument("generator needs at least 2 nodes");
+  }
+  if (max_cap < 1 || max_cap > (1 << 30)) {
+    throw std::invalid_argument("generator capacity out of range");
+  }
+  if (degree < 0) {
+    throw std::invalid_argument("generator degree is negative");
+  }
+  m_dims[0] = m_dims[1] = m_dims[2] = 1;
+  long long nnode = 0, narc = 0;
+  switch (family) {
+  case GRID_2D: {
+    if (m_degree == 0) {
+      m_degree = 4;
+    }
+    if (m_degree != 4 && m_degree != 8) {
+      throw std::invalid_argument("grid2d degree must be 4 or 8");
+    }
+    const long long w = rounded_root(nodes, 0.5);
+    const long long h = std::max(2LL, nodes / w);
+    m_dims[0] = int(w);
+    m_dims[1] = int(std::min(h, (long long)INT_MAX));
+    nnode = w * h;
+    narc = 2 * ((w - 1) * h + w * (h - 1));
+    if (m_degree == 8) {
+      narc += 4 * (w - 1) * (h - 1);
+    }
+    break;
+  }
+  case GRID_3D: {
+    if (m_degree == 0) {
+      m_degree = 6;
+    }
+    if (m_degree != 6) {
+      throw std::invalid_argument("grid3d degree must be 6");
+    }
+    const long long s = rounded_root(nodes, 1. / 3.);
+    const long long d = std::max(2LL, nodes / (s * s));
+    m_dims[0] = m_dims[1] = int(s);
+    m_dims[2] = int(std::min(d, (long long)INT_MAX));
+    nnode = s * s * d;
+    narc = 2 * (2 * (s - 1) * s * d + s * s * (d - 1));
+    break;
+  }
+  case RLG_WIDE:
+  case RLG_LONG:
+  case LAYERED: {
+    if (m_degree == 0) {
+      m_degree = family == LAYERED ? 4 : 3;
+    }
+    long long rows, levels;
+    if (family == RLG_WIDE) {
+      levels = std::min(64LL, std::max(2LL, nodes / 2));
+      rows = std::max(1LL, nodes / levels);
+    } else if (family == RLG_LONG) {
+      rows = std::min(64LL, std::max(1LL, nodes / 2));
+      levels = std::max(2LL, nodes / rows);
+    } else {
+      levels = std::max(2, int(std::sqrt(double(nodes)) / 4));
+      rows = std::max(1LL, nodes / levels);
+    }
+    m_dims[0] = int(std::min(rows, (long long)INT_MAX));
+    m_dims[1] = int(std::min(levels, (long long)INT_MAX));
+    nnode = rows * levels;
+    narc = (levels - 1) * rows * m_degree;
+    if (family == LAYERED) {
+      narc += (levels - 1) * rows;
+    }
+    break;
+  }
+  case AK: {
+    const long long k = std::max(2LL, nodes / 2);
+    m_dims[0] = int(std::min(k, (long long)INT_MAX));
+    nnode = 2 * k;
+    narc = 2 * (k - 1);
+    break;
+  }
+  case MATCHING: {
+    if (m_degree == 0) {
+      m_degree = 4;
+    }
+    const long long left = nodes / 2, right = nodes - left;
+    m_dims[0] = int(std::min(left, (long long)INT_MAX));
+    m_dims[1] = int(std::min(right, (long long)INT_MAX));
+    nnode = left + right;
+    narc = left * m_degree;
+    break;
+  }
+  case GENRMF: {
+    const long long a = rounded_root(nodes, 1. / 3.);
+    const long long frames = std::max(2LL, nodes / (a * a));
+    m_dims[0] = int(a);
+    m_dims[1] = int(std::min(frames, (long long)INT_MAX));
+    nnode = a * a * frames;
+    narc = frames * 4 * a * (a - 1) + (frames - 1) * a * a;
+    m_frame_cap = int(std::min((long long)max_cap * a * a, 1LL << 26));
+    break;
+  }
+  default:
+    throw std::invalid_argument("unknown generator family");
+  }
+  if (nnode > INT_MAX) {
+    throw std::invalid_argument("generator has too many nodes");
+  }
+  m_nnode = int(nnode);
+  m_narc = size_t(narc);
+
+  if (family == GRID_2D || family == GRID_3D) {
+    detail::Random random(m_seed, BLOB_STREAM);
+    const int side = family == GRID_2D
+                         ? std::min(m_dims[0], m_dims[1])
+                         : std::min(m_dims[0], std::min(m_dims[1], m_dims[2]));
+    for (int b = 0; b < NUM_BLOBS; ++b) {
+      blob disk;
+      disk.x = random.uniform01() * m_dims[0];
+      disk.y = random.uniform01() * m_dims[1];
+      disk.z = random.uniform01() * m_dims[2];
+      disk.r = (0.05 + 0.15 * random.uniform01()) * side;
+      m_blobs.push_back(disk);
+    }
+  }
+}
+
+GraphGenerator::Family GraphGenerator::parse_family(const std::string &name) {
+  for (int f = 0; f < NFAMILY; ++f) {
+    if (name == FAMILY_NAMES[f]) {
+      return Family(f);
+    }
+  }
+  throw std::invalid_argument("unknown generator family: " + name);
+}
+
+std::string GraphGenerator::shape() const {
+  const std::string w = std::to_string(m_dims[0]);
+  const std::string h = std::to_string(m_dims[1]);
+  switch (m_family) {
+  case GRID_2D:
+    return w + "x" + h;
+  case GRID_3D:
+    return w + "x" + h + "x" + std::to_string(m_dims[2]);
+  case RLG_WIDE:
+  case RLG_LONG:
+  case LAYERED:
+    return w + " rows x " + h + " levels";
+  case AK:
+    return "2 chains of " + w;
+  case MATCHING:
+    return w + "+" + h;
+  case GENRMF:
+    return w + "x" + w + "x" + h;
+  default:
+    return std::string();
+  }
+}
+
+double GraphGenerator::intensity(int x, int y, int z) const {
+  double value = 0.2;
+  for (const blob &b : m_blobs) {
+    const double dx = x - b.x, dy = y - b.y, dz = m_family == GRID_3D ? z - b.z
+                                                                       : 0.;
+    if (dx * dx + dy * dy + dz * dz <= b.r * b.r) {
+      value = 0.8;
+      break;
+    }
+  }
+  detail::Random random(m_seed, uint64_t(grid_node(x, y, z)));
+  value += 0.6 * random.uniform01() - 0.3;
+  return std::min(1., std::max(0., value));
+}
+
+int GraphGenerator::pair_cap(double a, double b, double weight) const {
+  // contrast sensitive Potts model
+  const double similarity = std::exp(-(a - b) * (a - b) / 0.1);
+  return 1 + int(weight * 0.5 * m_max_cap * similarity);
+}
+
+void GraphGenerator::frame_permutation(int frame,
+                                       std::vector<int> &perm) const {
+  const int cells = m_dims[0] * m_dims[0];
+  perm.resize(cells);
+  for (int j = 0; j < cells; ++j) {
+    perm[j] = j;
+  }
+  detail::Random random(m_seed, uint64_t(m_nnode) + uint64_t(m_dims[1]) +
+                                    uint64_t(frame));
+  for (int j = cells - 1; j > 0; --j) {
+    std::swap(perm[j], perm[random.uniform(0, j)]);
+  }
+}
+} // namespace io
+} // namespace maxflowlib
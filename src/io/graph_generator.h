@@ -0,0 +1,392 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file graph_generator.h
+ *
+ * @brief Generates the standard synthetic maxflow benchmark families straight
+ * into any graph, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-15
+ *
+ */
+#ifndef MAXFLOWLIB_IO_GRAPH_GENERATOR_H
+#define MAXFLOWLIB_IO_GRAPH_GENERATOR_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace maxflowlib {
+namespace io {
+
+namespace detail {
+
+/**
+ * @brief splitmix64 random numbers. A generator is seeded from the graph
+ * seed and a stream, e.g. a node, so every node draws the same numbers
+ * whatever order the graph is generated in.
+ */
+class Random {
+private:
+  uint64_t m_state;
+
+  static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+public:
+  Random(uint64_t seed, uint64_t stream)
+      : m_state(mix(seed ^ mix(stream + 0x9e3779b97f4a7c15ULL))) {}
+
+  uint64_t next() {
+    m_state += 0x9e3779b97f4a7c15ULL;
+    return mix(m_state);
+  }
+
+  /**
+   * @brief Uniform integer in [lo, hi]
+   */
+  long long uniform(long long lo, long long hi) {
+    return lo + (long long)(next() % uint64_t(hi - lo + 1));
+  }
+
+  /**
+   * @brief Uniform real in [0, 1)
+   */
+  double uniform01() { return double(next() >> 11) * (1. / 9007199254740992.); }
+};
+} // namespace detail
+
+/**
+ * @brief Generates a synthetic maxflow instance of one of the standard
+ * benchmark families. The graph only depends on the family, size, seed and
+ * parameters, nothing is stored, so instances of any size can be added to an
+ * engine or written with BinaryGraphWriter or CompressedGraphWriter.
+ *
+ * Families, n being the requested number of nodes:
+ *
+ *   grid2d    vision style segmentation of a noisy image of random disks,
+ *             4-connected or 8-connected with degree 8
+ *   grid3d    the same on a volume of random balls, 6-connected
+ *   rlg_wide  Washington random level graph, 64 levels of n / 64 nodes
+ *   rlg_long  Washington random level graph, n / 64 levels of 64 nodes
+ *   ak        the AK family, two chains of n / 2 nodes that are hard for
+ *             push relabel and augmenting paths, seed and capacity unused
+ *   layered   random layered graph, arcs to the next two layers and one back
+ *             to the layer before
+ *   matching  bipartite matching, n / 2 nodes on each side, unit capacities
+ *   genrmf    Goldfarb and Grigoriadis' RMF, a * a grid frames chained by
+ *             random permutations, source and sink at the first and last node
+ *
+ * Arcs that have capacity both ways are added as two arcs, as HPF takes no
+ * arc with both capacities. Capacities fit in 32 bits, the flows of very
+ * large instances may not.
+ */
+class GraphGenerator {
+public:
+  enum Family {
+    GRID_2D,
+    GRID_3D,
+    RLG_WIDE,
+    RLG_LONG,
+    AK,
+    LAYERED,
+    MATCHING,
+    GENRMF,
+    NFAMILY
+  };
+
+  static const char *const FAMILY_NAMES[NFAMILY];
+  static const int DEFAULT_MAX_CAP = 1000;
+
+private:
+  // a disk of the grid2d image, or a ball of the grid3d volume
+  struct blob {
+    double x, y, z, r;
+  };
+
+  Family m_family;
+  uint64_t m_seed;
+  int m_max_cap;
+  int m_degree;
+  // the shape: grid sides, rows and levels, or frame side and frames
+  int m_dims[3];
+  int m_nnode;
+  size_t m_narc;
+  std::vector<blob> m_blobs;
+  // genrmf capacity within frames
+  int m_frame_cap;
+
+  /**
+   * @brief Intensity in [0, 1] of a grid node, 1 in the foreground
+   */
+  double intensity(int x, int y, int z) const;
+
+  /**
+   * @brief Capacity of a grid arc, high between similar intensities
+   */
+  int pair_cap(double a, double b, double weight) const;
+
+  int grid_node(int x, int y, int z) const {
+    return (z * m_dims[1] + y) * m_dims[0] + x;
+  }
+
+  /**
+   * @brief Head of the genrmf arc leaving cell j of a frame for the next
+   * frame, a random permutation of the cells per frame
+   */
+  void frame_permutation(int frame, std::vector<int> &perm) const;
+
+  /**
+   * @brief Adds arcs both ways, not one arc with both capacities, which HPF
+   * does not take
+   */
+  template <typename Graph>
+  static void add_arc_pair(Graph &g, int u, int v, typename Graph::cap c) {
+    g.add_arc(u, v, c, 0);
+    g.add_arc(v, u, c, 0);
+  }
+
+  template <typename Graph> void generate_grid(Graph &g) const {
+    typedef typename Graph::cap cap;
+    const int w = m_dims[0], h = m_dims[1], d = m_dims[2];
+    for (int z = 0; z < d; ++z) {
+      for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+          const int u = grid_node(x, y, z);
+          const double a = intensity(x, y, z);
+          if (x + 1 < w) {
+            int c = pair_cap(a, intensity(x + 1, y, z), 1.);
+            add_arc_pair(g, u, grid_node(x + 1, y, z), cap(c));
+          }
+          if (y + 1 < h) {
+            int c = pair_cap(a, intensity(x, y + 1, z), 1.);
+            add_arc_pair(g, u, grid_node(x, y + 1, z), cap(c));
+          }
+          if (z + 1 < d) {
+            int c = pair_cap(a, intensity(x, y, z + 1), 1.);
+            add_arc_pair(g, u, grid_node(x, y, z + 1), cap(c));
+          }
+          if (m_degree == 8 && y + 1 < h) {
+            const double diagonal = 0.70710678118654752;
+            if (x + 1 < w) {
+              int c = pair_cap(a, intensity(x + 1, y + 1, z), diagonal);
+              add_arc_pair(g, u, grid_node(x + 1, y + 1, z), cap(c));
+            }
+            if (x > 0) {
+              int c = pair_cap(a, intensity(x - 1, y + 1, z), diagonal);
+              add_arc_pair(g, u, grid_node(x - 1, y + 1, z), cap(c));
+            }
+          }
+        }
+      }
+    }
+    for (int z = 0; z < d; ++z) {
+      for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+          int scap = int(m_max_cap * intensity(x, y, z) + 0.5);
+          g.set_tweights(grid_node(x, y, z), cap(scap),
+                         cap(m_max_cap - scap));
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Levels of rows nodes, every node but the last level has m_degree
+   * arcs to random nodes of the next span levels, and with back_arcs every
+   * node but the first level one arc to a random node of the level before
+   */
+  template <typename Graph>
+  void generate_levels(Graph &g, int span, bool back_arcs) const {
+    typedef typename Graph::cap cap;
+    const int rows = m_dims[0], levels = m_dims[1];
+    for (int l = 0; l < levels; ++l) {
+      const int reach = std::min(span, levels - 1 - l);
+      for (int r = 0; r < rows; ++r) {
+        const int u = l * rows + r;
+        detail::Random random(m_seed, uint64_t(u));
+        for (int k = 0; reach > 0 && k < m_degree; ++k) {
+          int next = l + int(random.uniform(1, reach));
+          int v = next * rows + int(random.uniform(0, rows - 1));
+          g.add_arc(u, v, cap(random.uniform(1, m_max_cap)), 0);
+        }
+        if (back_arcs && l > 0) {
+          int v = (l - 1) * rows + int(random.uniform(0, rows - 1));
+          g.add_arc(u, v, cap(random.uniform(1, m_max_cap)), 0);
+        }
+      }
+    }
+    for (int r = 0; r < rows; ++r) {
+      // streams past the nodes for the terminals
+      detail::Random random(m_seed, uint64_t(m_nnode) + uint64_t(r));
+      g.set_tweights(r, cap(random.uniform(1, m_max_cap)), 0);
+      g.set_tweights((levels - 1) * rows + r, 0,
+                     cap(random.uniform(1, m_max_cap)));
+    }
+  }
+
+  template <typename Graph> void generate_ak(Graph &g) const {
+    typedef typename Graph::cap cap;
+    // the first chain carries k units down a path that loses one at every
+    // node, the second collects one unit at every node
+    const int k = m_nnode / 2;
+    for (int i = 0; i + 1 < k; ++i) {
+      g.add_arc(i, i + 1, cap(k - 1 - i), 0);
+      g.add_arc(k + i, k + i + 1, cap(i + 1), 0);
+    }
+    for (int i = 0; i < k; ++i) {
+      g.set_tweights(i, cap(i == 0 ? k : 0), 1);
+      g.set_tweights(k + i, 1, cap(i + 1 == k ? k : 0));
+    }
+  }
+
+  template <typename Graph> void generate_matching(Graph &g) const {
+    typedef typename Graph::cap cap;
+    const int left = m_dims[0], right = m_dims[1];
+    for (int u = 0; u < left; ++u) {
+      detail::Random random(m_seed, uint64_t(u));
+      for (int k = 0; k < m_degree; ++k) {
+        g.add_arc(u, left + int(random.uniform(0, right - 1)), cap(1), 0);
+      }
+      g.set_tweights(u, cap(1), 0);
+    }
+    for (int v = left; v < left + right; ++v) {
+      g.set_tweights(v, 0, cap(1));
+    }
+  }
+
+  template <typename Graph> void generate_genrmf(Graph &g) const {
+    typedef typename Graph::cap cap;
+    const int a = m_dims[0], frames = m_dims[1], cells = a * a;
+    std::vector<int> perm;
+    for (int f = 0; f < frames; ++f) {
+      const int base = f * cells;
+      for (int y = 0; y < a; ++y) {
+        for (int x = 0; x < a; ++x) {
+          const int u = base + y * a + x;
+          if (x + 1 < a) {
+            add_arc_pair(g, u, u + 1, cap(m_frame_cap));
+          }
+          if (y + 1 < a) {
+            add_arc_pair(g, u, u + a, cap(m_frame_cap));
+          }
+        }
+      }
+      if (f + 1 < frames) {
+        frame_permutation(f, perm);
+        detail::Random random(m_seed, uint64_t(m_nnode) + uint64_t(f));
+        for (int j = 0; j < cells; ++j) {
+          g.add_arc(base + j, base + cells + perm[j],
+                    cap(random.uniform(1, m_max_cap)), 0);
+        }
+      }
+    }
+    // more than everything leaving the source or entering the sink node
+    g.set_tweights(0, cap(4 * m_frame_cap), 0);
+    g.set_tweights(m_nnode - 1, 0, cap(4 * m_frame_cap));
+  }
+
+public:
+  /**
+   * @brief Sets up a generator, n is rounded to the shape of the family
+   *
+   * @param family the family
+   * @param nodes the requested number of nodes
+   * @param seed the seed of every random choice
+   * @param max_cap capacities are drawn from [1, max_cap]
+   * @param degree arcs per node for the rlg, layered and matching families,
+   * 8 for an 8-connected grid2d, 0 for the family default
+   *
+   * @throws std::invalid_argument for too few or too many nodes, or a bad
+   * capacity or degree
+   */
+  GraphGenerator(Family family, long long nodes, uint64_t seed = 1,
+                 int max_cap = DEFAULT_MAX_CAP, int degree = 0);
+
+  /**
+   * @brief Family of a name of FAMILY_NAMES
+   *
+   * @throws std::invalid_argument for an unknown name
+   */
+  static Family parse_family(const std::string &name);
+
+  Family family() const { return m_family; }
+
+  int nnode() const { return m_nnode; }
+
+  size_t narc() const { return m_narc; }
+
+  /**
+   * @brief The shape the size was rounded to, e.g. "1000x1000" for grid2d
+   */
+  std::string shape() const;
+
+  /**
+   * @brief Adds the arcs and terminal capacities to a graph of nnode() nodes
+   *
+   * @param g the graph
+   */
+  template <typename Graph> void generate(Graph &g) const {
+    switch (m_family) {
+    case GRID_2D:
+    case GRID_3D:
+      generate_grid(g);
+      break;
+    case RLG_WIDE:
+    case RLG_LONG:
+      generate_levels(g, 1, false);
+      break;
+    case AK:
+      generate_ak(g);
+      break;
+    case LAYERED:
+      generate_levels(g, 2, true);
+      break;
+    case MATCHING:
+      generate_matching(g);
+      break;
+    case GENRMF:
+      generate_genrmf(g);
+      break;
+    default:
+      break;
+    }
+  }
+
+  /**
+   * @brief Allocates a graph and generates the instance into it
+   *
+   * @return a pointer to an allocated Graph
+   */
+  template <typename Graph> Graph *create() const {
+    // the number of arcs is only a hint, engines grow past it
+    Graph *g = new Graph(m_nnode, int(std::min(m_narc, size_t(INT_MAX))));
+    generate(*g);
+    return g;
+  }
+};
+} // namespace io
+} // namespace maxflowlib
+
+#endif
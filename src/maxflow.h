@@ -25,10 +25,153 @@
  */
 #ifndef MAXFLOWLIB_MAXFLOW_H
 #define MAXFLOWLIB_MAXFLOW_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace maxflowlib {
 
+namespace detail {
+
+/**
+ * @brief Bytes allocated by a vector, for memory_bytes
+ */
+template <typename T> size_t vector_bytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+
+inline size_t vector_bytes(const std::vector<bool> &v) {
+  return v.capacity() / 8;
+}
+} // namespace detail
+
+/**
+ * @brief Cancels a solve from another thread, copies share the same flag
+ */
+class CancellationToken {
+private:
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+
+public:
+  CancellationToken() : m_cancelled(new std::atomic<bool>(false)) {}
+
+  /**
+   * @brief Asks every solve holding this token to stop
+   */
+  void cancel() { m_cancelled->store(true, std::memory_order_relaxed); }
+
+  bool cancelled() const {
+    return m_cancelled->load(std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Outcome of Graph::check_flow
+ */
+enum FlowCheck { FLOW_UNCHECKED, FLOW_VALID, FLOW_INVALID };
+
+/**
+ * @brief Bounds on the maxflow reported while solving
+ */
+struct SolveProgress {
+  // flow found so far
+  double lower_bound;
+  // capacity of the cut the algorithm currently implies
+  double upper_bound;
+  double seconds;
+};
+
+/**
+ * @brief When a solve should stop early
+ */
+struct SolveOptions {
+  typedef std::chrono::steady_clock clock;
+
+  clock::time_point deadline;
+  CancellationToken token;
+  // called about every progress_interval seconds, returning false stops the
+  // solve (e.g. once the gap is small enough)
+  std::function<bool(const SolveProgress &)> progress;
+  double progress_interval;
+
+  SolveOptions() : deadline(clock::time_point::max()), progress_interval(0.1) {}
+
+  /**
+   * @brief Options with a deadline seconds from now
+   */
+  static SolveOptions within(double seconds) {
+    SolveOptions options;
+    options.deadline =
+        clock::now() + std::chrono::duration_cast<clock::duration>(
+                           std::chrono::duration<double>(seconds));
+    return options;
+  }
+
+  /**
+   * @brief Whether the token was cancelled or the deadline passed
+   */
+  bool expired() const {
+    return token.cancelled() ||
+           (deadline != clock::time_point::max() && clock::now() >= deadline);
+  }
+};
+
+/**
+ * @brief Watches a solve for the interrupt hooks of the algorithms: checks
+ * the options and reports progress with the bounds of the algorithm
+ */
+class SolveMonitor {
+private:
+  typedef SolveOptions::clock clock;
+
+  const SolveOptions &m_options;
+  // fills the current lower and upper bound
+  std::function<void(double &, double &)> m_bounds;
+  clock::time_point m_start, m_next_progress;
+
+public:
+  SolveMonitor(const SolveOptions &options,
+               std::function<void(double &, double &)> bounds)
+      : m_options(options), m_bounds(bounds), m_start(clock::now()),
+        m_next_progress(m_start) {}
+
+  /**
+   * @brief Whether the solve should stop
+   */
+  bool check() {
+    if (m_options.expired()) {
+      return true;
+    }
+    if (!m_options.progress) {
+      return false;
+    }
+    const clock::time_point now = clock::now();
+    if (now < m_next_progress) {
+      return false;
+    }
+    m_next_progress =
+        now + std::chrono::duration_cast<clock::duration>(
+                  std::chrono::duration<double>(m_options.progress_interval));
+    SolveProgress progress;
+    m_bounds(progress.lower_bound, progress.upper_bound);
+    progress.seconds = std::chrono::duration<double>(now - m_start).count();
+    return !m_options.progress(progress);
+  }
+
+  /**
+   * @brief Interrupt hook, data points to the SolveMonitor
+   */
+  static bool check(void *data) {
+    return static_cast<SolveMonitor *>(data)->check();
+  }
+};
+
 template <typename _nodeid, typename _arcid, typename _cap, typename _flow>
 class Graph {
 
@@ -41,15 +184,19 @@ public:
 protected:
   nodeid m_nnode;
   arcid m_narc;
+  bool m_interrupted;
 
 public:
   /**
    * @brief Graph class constructor
    *
    * @param nnode number of nodes in the graph
-   * @param narc  number of arcs in the graph
+   * @param narc  number of arcs in the graph, a hint: GraphBK, GraphIBFS and
+   * GraphHPF grow their arc storage for more arcs, so it may be 0 when the
+   * count is not known upfront
    */
-  Graph(nodeid nnode, arcid narc) : m_nnode(nnode), m_narc(narc) {}
+  Graph(nodeid nnode, arcid narc)
+      : m_nnode(nnode), m_narc(narc), m_interrupted(false) {}
 
   /**
    * @brief Destructor
@@ -76,6 +223,24 @@ public:
    */
   virtual void set_tweights(nodeid s, cap scap, cap tcap) = 0;
 
+  /**
+   * @brief Clears the graph so it can be filled again, reusing its memory
+   * when it is large enough
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   */
+  virtual void reset(nodeid /*nnode*/, arcid /*narc*/) {
+    throw std::logic_error("This algorithm does not support reset, do not use.");
+  }
+
+  /**
+   * @brief Builds the algorithm's own graph from the added arcs. maxflow()
+   * does so when it has not been done, calling it first only separates the
+   * two, e.g. to time them. No arcs may be added afterwards.
+   */
+  virtual void init_graph() {}
+
   /**
    * @brief Compute the pseudoflow.
    *
@@ -92,6 +257,54 @@ public:
    */
   virtual flow maxflow() = 0;
 
+  /**
+   * @brief Compute the maxflow, stopping early once options expire or the
+   * progress callback returns false. Algorithms without interrupt checks run
+   * to completion and do not report progress.
+   *
+   * @return the maxflow, or a lower bound on it when interrupted(), in which
+   * case what_segment gives a valid, possibly not minimum, cut
+   */
+  virtual flow maxflow_until(const SolveOptions & /*options*/) {
+    m_interrupted = false;
+    return maxflow();
+  }
+
+  /**
+   * @brief Compute the maxflow on another thread, see maxflow_until. The
+   * graph must outlive the future and not be used until it is ready.
+   */
+  std::future<flow> maxflow_async(SolveOptions options) {
+    return std::async(std::launch::async,
+                      [this, options]() { return maxflow_until(options); });
+  }
+
+  /**
+   * @brief Whether the last maxflow_until call stopped early
+   */
+  bool interrupted() const { return m_interrupted; }
+
+  /**
+   * @brief Bytes the algorithm currently holds for its nodes, arcs and
+   * auxiliary buffers, not counting the graph object itself
+   *
+   * @return the byte count, 0 for algorithms that do not report it
+   */
+  virtual size_t memory_bytes() const { return 0; }
+
+  /**
+   * @brief Checks the arc flows of the last maxflow: capacities, flow
+   * conservation at every node and that the flow equals the cut. Only
+   * algorithms that keep an explicit flow can check it.
+   *
+   * @param error set to what is wrong when the flow is invalid
+   *
+   * @return FLOW_UNCHECKED when the algorithm has no flow to check
+   */
+  virtual FlowCheck check_flow(std::string & /*error*/) {
+    return FLOW_UNCHECKED;
+  }
+
   /**
    * @brief Return which segment a node belongs to in the minimum cut
    *
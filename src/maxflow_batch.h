@@ -0,0 +1,341 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_batch.h
+ *
+ * @brief Solves many small independent graphs, packed in one buffer, in
+ * parallel with any of the directed maxflow implementations.
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-10
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_BATCH_H
+#define MAXFLOWLIB_MAXFLOW_BATCH_H
+
+#include "maxflow.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "util/thread_pool.h"
+#include "util/timer.h"
+
+namespace maxflowlib {
+
+/**
+ * @brief What the last BatchSolver::solve call did
+ */
+struct BatchStats {
+  size_t graphs;
+  size_t nodes;
+  size_t arcs;
+  // graphs without both source and sink arcs, placed without the engine
+  size_t trivial;
+  double solve_seconds;
+
+  BatchStats() : graphs(0), nodes(0), arcs(0), trivial(0), solve_seconds(0) {}
+};
+
+/**
+ * @brief Solves a batch of independent graphs with a directed maxflow
+ * implementation.
+ *
+ * Graphs are appended to one packed buffer: add_graph() starts a graph and
+ * add_arc() / set_tweights() then refer to its nodes by local ids
+ * 0..nnode-1. solve() hands the graphs to the threads in small chunks taken
+ * off a shared counter, so a thread that finishes early takes the next
+ * chunk. Every thread keeps one engine and reset()s it for the next graph,
+ * so its memory is reused across graphs and batches. Flows come back one per
+ * graph and cuts packed in the same node order as the input, graph g
+ * starting at node_offset(g).
+ *
+ * With more than one thread several engine graphs are alive and solved at
+ * once, which engines with global state (GraphHPF) do not support.
+ */
+template <typename GraphMaxflow> class BatchSolver {
+public:
+  typedef typename GraphMaxflow::nodeid nodeid;
+  typedef typename GraphMaxflow::arcid arcid;
+  typedef typename GraphMaxflow::cap cap;
+  typedef typename GraphMaxflow::flow flow;
+
+private:
+  struct input_arc {
+    nodeid s, t;
+    cap fcap, rcap;
+  };
+
+  // graphs handed to a thread at a time
+  static const size_t GRAIN = 4;
+
+  std::vector<size_t> m_node_offset;
+  std::vector<size_t> m_arc_offset;
+  std::vector<input_arc> m_arcs;
+  std::vector<cap> m_source_cap;
+  std::vector<cap> m_sink_cap;
+
+  unsigned m_num_threads;
+  std::unique_ptr<util::ThreadPool> m_pool;
+  // one engine per thread, reset() for every graph it solves
+  std::vector<std::unique_ptr<GraphMaxflow>> m_engines;
+  std::atomic<bool> m_engine_reset;
+
+  BatchStats m_stats;
+  std::vector<flow> m_flows;
+  // written concurrently, so not a vector<bool>
+  std::vector<char> m_what_segment;
+
+  nodeid graph_nnode(size_t g) const {
+    return nodeid(m_node_offset[g + 1] - m_node_offset[g]);
+  }
+
+  /**
+   * @brief Solves graph g or places it if it carries no flow
+   *
+   * @return whether the engine was used
+   */
+  bool solve_graph(size_t g, unsigned thread_id) {
+    const size_t first = m_node_offset[g];
+    const nodeid nnode = graph_nnode(g);
+    const cap *source_cap = &m_source_cap[0] + first;
+    const cap *sink_cap = &m_sink_cap[0] + first;
+    char *what_segment = &m_what_segment[0] + first;
+    bool has_source = false, has_sink = false;
+    for (nodeid i = 0; i < nnode; ++i) {
+      has_source |= source_cap[i] > 0;
+      has_sink |= sink_cap[i] > 0;
+    }
+    if (!has_source || !has_sink) {
+      m_flows[g] = 0;
+      for (nodeid i = 0; i < nnode; ++i) {
+        m_flows[g] += std::min(source_cap[i], sink_cap[i]);
+        what_segment[i] = source_cap[i] < sink_cap[i] || !has_source;
+      }
+      return false;
+    }
+    const arcid narc = arcid(m_arc_offset[g + 1] - m_arc_offset[g]);
+    GraphMaxflow &graph = engine(thread_id, nnode, narc);
+    for (size_t k = m_arc_offset[g]; k < m_arc_offset[g + 1]; ++k) {
+      const input_arc &a = m_arcs[k];
+      graph.add_arc(a.s, a.t, a.fcap, a.rcap);
+    }
+    for (nodeid i = 0; i < nnode; ++i) {
+      if (source_cap[i] > 0 || sink_cap[i] > 0) {
+        graph.set_tweights(i, source_cap[i], sink_cap[i]);
+      }
+    }
+    m_flows[g] = graph.maxflow();
+    for (nodeid i = 0; i < nnode; ++i) {
+      what_segment[i] = graph.what_segment(i);
+    }
+    return true;
+  }
+
+  /**
+   * @brief The engine of a thread, emptied for a graph of nnode nodes and
+   * narc arcs. Engines without reset() are built anew every time.
+   */
+  GraphMaxflow &engine(unsigned thread_id, nodeid nnode, arcid narc) {
+    std::unique_ptr<GraphMaxflow> &graph = m_engines[thread_id];
+    if (graph && m_engine_reset) {
+      try {
+        graph->reset(nnode, narc);
+        return *graph;
+      } catch (const std::logic_error &) {
+        m_engine_reset = false;
+      }
+    }
+    graph.reset(new GraphMaxflow(nnode, narc));
+    return *graph;
+  }
+
+public:
+  /**
+   * @brief BatchSolver class constructor
+   *
+   * @param num_threads threads solving graphs, 0 uses the hardware
+   * concurrency
+   */
+  explicit BatchSolver(unsigned num_threads = 0)
+      : m_node_offset(1, 0), m_arc_offset(1, 0), m_num_threads(num_threads),
+        m_engine_reset(true) {}
+
+  /**
+   * @brief Reserves the packed buffer
+   *
+   * @param ngraph total number of graphs
+   * @param nnode total number of nodes over all graphs
+   * @param narc total number of arcs over all graphs
+   */
+  void reserve(size_t ngraph, size_t nnode, size_t narc) {
+    m_node_offset.reserve(ngraph + 1);
+    m_arc_offset.reserve(ngraph + 1);
+    m_arcs.reserve(narc);
+    m_source_cap.reserve(nnode);
+    m_sink_cap.reserve(nnode);
+  }
+
+  /**
+   * @brief Removes all graphs, keeping the memory of the packed buffer
+   */
+  void clear() {
+    m_node_offset.assign(1, 0);
+    m_arc_offset.assign(1, 0);
+    m_arcs.clear();
+    m_source_cap.clear();
+    m_sink_cap.clear();
+    m_flows.clear();
+    m_what_segment.clear();
+  }
+
+  /**
+   * @brief Number of graphs in the batch
+   */
+  size_t size() const { return m_node_offset.size() - 1; }
+
+  /**
+   * @brief Starts a new graph, following add_arc and set_tweights calls refer
+   * to it
+   *
+   * @param nnode number of nodes in the graph
+   *
+   * @return index of the graph in the batch
+   */
+  size_t add_graph(nodeid nnode) {
+    m_node_offset.push_back(m_node_offset.back() + size_t(nnode));
+    m_arc_offset.push_back(m_arc_offset.back());
+    m_source_cap.resize(m_node_offset.back(), 0);
+    m_sink_cap.resize(m_node_offset.back(), 0);
+    return size() - 1;
+  }
+
+  /**
+   * @brief Adds an arc to the last graph (also adds the residual (reverse)
+   * arc)
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    if (size() == 0) {
+      throw std::logic_error("add_graph must be called before add_arc.");
+    }
+    input_arc a = {s, t, fcap, rcap};
+    m_arcs.push_back(a);
+    m_arc_offset.back()++;
+  }
+
+  /**
+   * @brief Adds source and sink connection to a node of the last graph,
+   * capacities of repeated calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    if (size() == 0) {
+      throw std::logic_error("add_graph must be called before set_tweights.");
+    }
+    const size_t u = m_node_offset[size() - 1] + size_t(s);
+    m_source_cap[u] += scap;
+    m_sink_cap[u] += tcap;
+  }
+
+  /**
+   * @brief Statistics of the last solve call
+   */
+  const BatchStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Compute the maxflow of every graph
+   */
+  void solve() {
+    m_stats = BatchStats();
+    util::Timer timer;
+    timer.tic();
+    const size_t ngraph = size();
+    m_flows.assign(ngraph, 0);
+    m_what_segment.assign(m_node_offset.back(), 0);
+    std::vector<char> solved(ngraph, 0);
+    unsigned num_threads = m_num_threads;
+    if (num_threads == 0) {
+      num_threads = std::thread::hardware_concurrency();
+    }
+    if (num_threads > 1 && ngraph > GRAIN) {
+      if (!m_pool || m_pool->size() != num_threads) {
+        m_pool.reset(new util::ThreadPool(num_threads));
+      }
+      m_engines.resize(std::max(m_engines.size(), size_t(num_threads)));
+      m_pool->parallel_for(0, ngraph, GRAIN, [&](size_t g, unsigned thread_id) {
+        solved[g] = solve_graph(g, thread_id);
+      });
+    } else {
+      m_engines.resize(std::max(m_engines.size(), size_t(1)));
+      for (size_t g = 0; g < ngraph; ++g) {
+        solved[g] = solve_graph(g, 0);
+      }
+    }
+    timer.toc();
+    m_stats.graphs = ngraph;
+    m_stats.nodes = m_node_offset.back();
+    m_stats.arcs = m_arcs.size();
+    m_stats.trivial = ngraph - size_t(std::count(solved.begin(), solved.end(),
+                                                 char(1)));
+    m_stats.solve_seconds = timer.elapsed_seconds();
+  }
+
+  /**
+   * @brief Maxflow of every graph, in batch order
+   */
+  const std::vector<flow> &flows() const { return m_flows; }
+
+  /**
+   * @brief Segment of every node, packed in batch order, 0 - source segment
+   * or 1 - sink segment
+   */
+  const std::vector<char> &segments() const { return m_what_segment; }
+
+  /**
+   * @brief Index in segments() of the first node of graph g
+   */
+  size_t node_offset(size_t g) const { return m_node_offset[g]; }
+
+  /**
+   * @brief Return which segment a node of graph g belongs to in the minimum
+   * cut
+   *
+   * @param g the graph
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(size_t g, nodeid s) const {
+    return m_what_segment[m_node_offset[g] + size_t(s)] != 0;
+  }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -56,13 +56,27 @@ public:
    * @brief GraphBk class constructor
    *
    * @param nnode number of nodes in the graph
-   * @param narc  number of arcs in the graph
+   * @param narc  number of arcs in the graph, more may be added
    */
   GraphBK(nodeid nnode, arcid narc)
       : BaseGraph(nnode, narc), m_graph(nnode, narc) {
     m_graph.add_node(BaseGraph::m_nnode);
   }
 
+  /**
+   * @brief Clears the graph so it can be filled again, reusing its memory
+   * when it is large enough
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   */
+  void reset(nodeid nnode, arcid narc) {
+    BaseGraph::m_nnode = nnode;
+    BaseGraph::m_narc = narc;
+    m_graph.reset();
+    m_graph.add_node(BaseGraph::m_nnode);
+  }
+
   /**
    * @brief Adds an arc to the residual graph (also adds the residual (reverse)
    * arc)
@@ -95,6 +109,26 @@ public:
    */
   flow maxflow() { return m_graph.maxflow(); }
 
+  size_t memory_bytes() const { return m_graph.get_memory_bytes(); }
+
+  /**
+   * @brief Compute the maxflow, stopping early once options expire or the
+   * progress callback returns false, bounds come from the search trees
+   *
+   * @return the maxflow, or a lower bound on it when interrupted()
+   */
+  flow maxflow_until(const SolveOptions &options) {
+    SolveMonitor monitor(options, [this](double &lower, double &upper) {
+      lower = double(m_graph.current_flow());
+      upper = double(m_graph.cut_capacity());
+    });
+    m_graph.set_interrupt(&SolveMonitor::check, &monitor);
+    flow f = m_graph.maxflow();
+    m_graph.set_interrupt(NULL, NULL);
+    BaseGraph::m_interrupted = m_graph.interrupted();
+    return f;
+  }
+
   /**
    * @brief Return which segment a node belongs to in the minimum cut
    *
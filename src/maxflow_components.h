@@ -0,0 +1,350 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_components.h
+ *
+ * @brief Implementation of maxflow interface that solves every connected
+ * component of the graph separately with any of the directed maxflow
+ * implementations.
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-05
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_COMPONENTS_H
+#define MAXFLOWLIB_MAXFLOW_COMPONENTS_H
+
+#include "maxflow.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "util/adjacency_lists.h"
+#include "util/thread_pool.h"
+#include "util/timer.h"
+
+namespace maxflowlib {
+
+/**
+ * @brief What the last GraphComponents::maxflow call did
+ */
+struct ComponentsStats {
+  size_t components;
+  // components with both source and sink arcs, solved by the engine
+  size_t solved;
+  size_t largest_solved;
+  double split_seconds;
+  double solve_seconds;
+
+  ComponentsStats()
+      : components(0), solved(0), largest_solved(0), split_seconds(0),
+        solve_seconds(0) {}
+};
+
+/**
+ * @brief Wraps a directed maxflow implementation, splitting the graph into
+ * its connected components and solving each separately, possibly in
+ * parallel. Arcs with no capacity either way do not connect nodes.
+ *
+ * A component without source arcs lies on the sink side and one without
+ * sink arcs on the source side, neither carries flow, so only components
+ * with both are handed to the engine. Single nodes are solved directly.
+ *
+ * With more than one thread several engine graphs are alive and solved at
+ * once, which engines with global state (GraphHPF) do not support.
+ */
+template <typename GraphMaxflow>
+class GraphComponents
+    : public Graph<typename GraphMaxflow::nodeid, typename GraphMaxflow::arcid,
+                   typename GraphMaxflow::cap, typename GraphMaxflow::flow> {
+public:
+  typedef typename GraphMaxflow::nodeid nodeid;
+  typedef typename GraphMaxflow::arcid arcid;
+  typedef typename GraphMaxflow::cap cap;
+  typedef typename GraphMaxflow::flow flow;
+  typedef Graph<nodeid, arcid, cap, flow> BaseGraph;
+
+private:
+  struct input_arc {
+    nodeid s, t;
+    cap fcap, rcap;
+  };
+
+  std::vector<input_arc> m_arcs;
+  std::vector<cap> m_source_cap;
+  std::vector<cap> m_sink_cap;
+  // union-find forest over the nodes, maintained as arcs are added
+  std::vector<nodeid> m_parent;
+  std::vector<nodeid> m_size;
+
+  unsigned m_num_threads;
+  std::unique_ptr<util::ThreadPool> m_pool;
+
+  // nodes and arcs bucketed by component, with the index of every node in
+  // its component
+  std::vector<nodeid> m_component;
+  std::vector<size_t> m_node_offset, m_arc_offset;
+  std::vector<nodeid> m_component_nodes;
+  std::vector<arcid> m_component_arcs;
+  std::vector<nodeid> m_local_id;
+  std::vector<flow> m_component_flow;
+
+  ComponentsStats m_stats;
+  // written concurrently, so not a vector<bool>
+  std::vector<char> m_what_segment;
+
+  void unite(nodeid u, nodeid v) {
+    u = util::find_root(m_parent, u);
+    v = util::find_root(m_parent, v);
+    if (u == v) {
+      return;
+    }
+    if (m_size[u] > m_size[v]) {
+      std::swap(u, v);
+    }
+    m_parent[u] = v;
+    m_size[v] += m_size[u];
+  }
+
+  /**
+   * @brief Numbers the components and buckets their nodes and arcs
+   *
+   * @return number of components
+   */
+  nodeid split_components() {
+    const nodeid n = BaseGraph::m_nnode;
+    m_component.assign(n, -1);
+    nodeid num_component = 0;
+    for (nodeid u = 0; u < n; ++u) {
+      nodeid root = util::find_root(m_parent, u);
+      if (m_component[root] < 0) {
+        m_component[root] = num_component++;
+      }
+      m_component[u] = m_component[root];
+    }
+    m_node_offset.assign(num_component + 1, 0);
+    m_arc_offset.assign(num_component + 1, 0);
+    for (nodeid u = 0; u < n; ++u) {
+      m_node_offset[m_component[u] + 1]++;
+    }
+    for (const input_arc &a : m_arcs) {
+      m_arc_offset[m_component[a.s] + 1]++;
+    }
+    for (nodeid c = 0; c < num_component; ++c) {
+      m_node_offset[c + 1] += m_node_offset[c];
+      m_arc_offset[c + 1] += m_arc_offset[c];
+    }
+    m_component_nodes.resize(n);
+    m_component_arcs.resize(m_arcs.size());
+    m_local_id.resize(n);
+    std::vector<size_t> next(m_node_offset.begin(), m_node_offset.end() - 1);
+    for (nodeid u = 0; u < n; ++u) {
+      nodeid c = m_component[u];
+      m_local_id[u] = nodeid(next[c] - m_node_offset[c]);
+      m_component_nodes[next[c]++] = u;
+    }
+    next.assign(m_arc_offset.begin(), m_arc_offset.end() - 1);
+    for (size_t i = 0; i < m_arcs.size(); ++i) {
+      m_component_arcs[next[m_component[m_arcs[i].s]]++] = arcid(i);
+    }
+    return num_component;
+  }
+
+  /**
+   * @brief Solves component c or places it if it carries no flow
+   *
+   * @return whether the engine was used
+   */
+  bool solve_component(nodeid c) {
+    const nodeid *nodes = &m_component_nodes[m_node_offset[c]];
+    const nodeid nnode = nodeid(m_node_offset[c + 1] - m_node_offset[c]);
+    bool has_source = false, has_sink = false;
+    for (nodeid i = 0; i < nnode; ++i) {
+      has_source |= m_source_cap[nodes[i]] > 0;
+      has_sink |= m_sink_cap[nodes[i]] > 0;
+    }
+    if (!has_source || !has_sink || nnode == 1) {
+      m_component_flow[c] = 0;
+      for (nodeid i = 0; i < nnode; ++i) {
+        nodeid u = nodes[i];
+        m_component_flow[c] += std::min(m_source_cap[u], m_sink_cap[u]);
+        m_what_segment[u] = m_source_cap[u] < m_sink_cap[u] || !has_source;
+      }
+      return false;
+    }
+    const arcid narc = arcid(m_arc_offset[c + 1] - m_arc_offset[c]);
+    GraphMaxflow graph(nnode, narc);
+    for (size_t k = m_arc_offset[c]; k < m_arc_offset[c + 1]; ++k) {
+      const input_arc &a = m_arcs[m_component_arcs[k]];
+      graph.add_arc(m_local_id[a.s], m_local_id[a.t], a.fcap, a.rcap);
+    }
+    for (nodeid i = 0; i < nnode; ++i) {
+      nodeid u = nodes[i];
+      if (m_source_cap[u] > 0 || m_sink_cap[u] > 0) {
+        graph.set_tweights(i, m_source_cap[u], m_sink_cap[u]);
+      }
+    }
+    m_component_flow[c] = graph.maxflow();
+    for (nodeid i = 0; i < nnode; ++i) {
+      m_what_segment[nodes[i]] = graph.what_segment(i);
+    }
+    return true;
+  }
+
+public:
+  /**
+   * @brief GraphComponents class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   * @param num_threads threads solving components, 0 uses the hardware
+   * concurrency
+   */
+  GraphComponents(nodeid nnode, arcid narc, unsigned num_threads = 1)
+      : BaseGraph(nnode, narc), m_source_cap(nnode, 0), m_sink_cap(nnode, 0),
+        m_parent(nnode), m_size(nnode, 1), m_num_threads(num_threads) {
+    m_arcs.reserve(narc);
+    for (nodeid u = 0; u < nnode; ++u) {
+      m_parent[u] = u;
+    }
+  }
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const ComponentsStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Adds an arc to the residual graph (also adds the residual (reverse)
+   * arc)
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    if (s != t && (fcap > 0 || rcap > 0)) {
+      input_arc a = {s, t, fcap, rcap};
+      m_arcs.push_back(a);
+      unite(s, t);
+    }
+  }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    m_source_cap[s] += scap;
+    m_sink_cap[s] += tcap;
+  }
+
+  /**
+   * @brief Compute the maxflow
+   *
+   * @return the maxflow
+   */
+  flow maxflow() {
+    m_stats = ComponentsStats();
+    util::Timer timer_split;
+    timer_split.tic();
+    const nodeid num_component = split_components();
+    // largest components first to balance the threads
+    std::vector<nodeid> order(num_component);
+    for (nodeid c = 0; c < num_component; ++c) {
+      order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), [&](nodeid a, nodeid b) {
+      return m_node_offset[a + 1] - m_node_offset[a] >
+             m_node_offset[b + 1] - m_node_offset[b];
+    });
+    timer_split.toc();
+
+    util::Timer timer_solve;
+    timer_solve.tic();
+    m_component_flow.assign(num_component, 0);
+    m_what_segment.assign(BaseGraph::m_nnode, 0);
+    std::vector<char> solved(num_component, 0);
+    unsigned num_threads = m_num_threads;
+    if (num_threads == 0) {
+      num_threads = std::thread::hardware_concurrency();
+    }
+    if (num_threads > 1) {
+      if (!m_pool || m_pool->size() != num_threads) {
+        m_pool.reset(new util::ThreadPool(num_threads));
+      }
+      m_pool->parallel_for(0, order.size(), 1, [&](size_t i, unsigned) {
+        solved[order[i]] = solve_component(order[i]);
+      });
+    } else {
+      for (nodeid c : order) {
+        solved[c] = solve_component(c);
+      }
+    }
+    timer_solve.toc();
+
+    flow f = 0;
+    for (nodeid c = 0; c < num_component; ++c) {
+      f += m_component_flow[c];
+      if (solved[c]) {
+        m_stats.solved++;
+        m_stats.largest_solved =
+            std::max(m_stats.largest_solved,
+                     size_t(m_node_offset[c + 1] - m_node_offset[c]));
+      }
+    }
+    m_stats.components = size_t(num_component);
+    m_stats.split_seconds = timer_split.elapsed_seconds();
+    m_stats.solve_seconds = timer_solve.elapsed_seconds();
+    return f;
+  }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) { return m_what_segment[s]; }
+
+  /**
+   * @brief Bytes held for the split, the component graphs are only alive
+   * while they are solved and not counted
+   */
+  size_t memory_bytes() const {
+    using detail::vector_bytes;
+    return vector_bytes(m_arcs) + vector_bytes(m_source_cap) +
+           vector_bytes(m_sink_cap) + vector_bytes(m_parent) +
+           vector_bytes(m_size) + vector_bytes(m_component) +
+           vector_bytes(m_node_offset) + vector_bytes(m_arc_offset) +
+           vector_bytes(m_component_nodes) + vector_bytes(m_component_arcs) +
+           vector_bytes(m_local_id) + vector_bytes(m_component_flow) +
+           vector_bytes(m_what_segment);
+  }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -0,0 +1,438 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_dual_decomposition.h
+ *
+ * @brief Implementation of maxflow interface solving blocks of the graph in
+ * parallel with the BK algorithm and dual decomposition
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-06
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_DUAL_DECOMPOSITION_H
+#define MAXFLOWLIB_MAXFLOW_DUAL_DECOMPOSITION_H
+
+#include "algorithms/bk/graph.h"
+#include "maxflow.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/thread_pool.h"
+
+namespace maxflowlib {
+
+/**
+ * @brief What the last GraphDualDecomposition::maxflow call did
+ */
+struct DualDecompositionStats {
+  size_t blocks;
+  // nodes duplicated into the block of a neighbor
+  size_t copies;
+  size_t iterations;
+  // times neighboring blocks were merged because the copies stopped agreeing
+  // more
+  size_t merges;
+  size_t final_blocks;
+
+  DualDecompositionStats()
+      : blocks(0), copies(0), iterations(0), merges(0), final_blocks(0) {}
+};
+
+template <typename _nodeid = int, typename _arcid = int, typename _cap = int,
+          typename _flow = int>
+class GraphDualDecomposition {};
+
+/**
+ * @brief Parallel maxflow by dual decomposition (Strandmark and Kahl,
+ * Parallel and Distributed Graph Cuts by Dual Decomposition, CVPR 2010).
+ *
+ * The node range is split into contiguous blocks, one per thread. An arc
+ * between two blocks goes to the lower one, which gets a copy of the other
+ * end. Each block is solved with its own BK graph. A copy and its node
+ * must end up on the same side; where they do not, a Lagrange multiplier
+ * on the pair is moved by a subgradient step, the affected terminal
+ * capacities are updated, and the blocks are solved again reusing their
+ * search trees. Once all copies agree the cut is a minimum cut of the whole
+ * graph.
+ *
+ * Ties between cuts can keep a few copies disagreeing forever. When the
+ * disagreements stop going down, neighboring blocks are merged, keeping the
+ * multipliers of the copies left, and solved again. At worst this ends in
+ * a single block, so the result is always exact.
+ *
+ * Blocks follow node ids, so this works best when arcs mostly join nodes
+ * with close ids, as in row-major grids and volumes. Integer capacities are
+ * scaled by SCALE in the blocks, so flows must fit with that much headroom.
+ */
+template <typename _cap, typename _flow>
+class GraphDualDecomposition<int, int, _cap, _flow>
+    : public Graph<int, int, _cap, _flow> {
+
+public:
+  typedef Graph<int, int, _cap, _flow> BaseGraph;
+  typedef ::Graph<_cap, _cap, _flow> GraphImpl;
+  typedef typename BaseGraph::nodeid nodeid;
+  typedef typename BaseGraph::arcid arcid;
+  typedef typename BaseGraph::cap cap;
+  typedef typename BaseGraph::flow flow;
+
+  // integer capacities are scaled in the blocks so multipliers can take
+  // fractional values, without which far fewer blocks agree
+  static constexpr cap SCALE = std::numeric_limits<cap>::is_integer ? 8 : 1;
+
+private:
+  struct input_arc {
+    nodeid s, t;
+    cap fcap, rcap;
+  };
+
+  /**
+   * @brief A node duplicated into the block of a neighbor. The constraint
+   * that both are on the same side gets a multiplier, moved in steps that
+   * are halved whenever it changes direction.
+   */
+  struct node_copy {
+    nodeid node;
+    int block;
+    nodeid local;
+    cap lambda;
+    cap step;
+    int last_sign;
+  };
+
+  std::vector<input_arc> m_arcs;
+  std::vector<cap> m_source_cap;
+  std::vector<cap> m_sink_cap;
+
+  unsigned m_num_threads;
+  int m_stall_iterations;
+  std::unique_ptr<util::ThreadPool> m_pool;
+
+  nodeid m_block_size;
+  std::vector<std::unique_ptr<GraphImpl>> m_blocks;
+  // sorted by block and node
+  std::vector<node_copy> m_copies;
+
+  DualDecompositionStats m_stats;
+  std::vector<bool> m_what_segment;
+
+  int block_of(nodeid u) const { return int(u / m_block_size); }
+
+  nodeid local_id(nodeid u) const { return u % m_block_size; }
+
+  node_copy &find_copy(int b, nodeid v) {
+    return *std::lower_bound(m_copies.begin(), m_copies.end(), b,
+                             [v](const node_copy &c, int block) {
+                               return c.block < block ||
+                                      (c.block == block && c.node < v);
+                             });
+  }
+
+  /**
+   * @brief Adds the unary term delta * x to node i of g, x being 1 on the
+   * sink side, up to a constant.
+   */
+  static void add_unary(GraphImpl &g, nodeid i, cap delta) {
+    if (delta > 0) {
+      g.add_tweights(i, delta, 0);
+    } else {
+      g.add_tweights(i, 0, -delta);
+    }
+  }
+
+  /**
+   * @brief Builds the graph of every block with the copies it needs
+   *
+   * @param block_size nodes per block
+   * @param previous copies of the blocks before merging, with the index of
+   * the merged block, whose multipliers carry over
+   */
+  void build_blocks(nodeid block_size, const std::vector<node_copy> &previous) {
+    const nodeid n = BaseGraph::m_nnode;
+    m_block_size = block_size;
+    const int num_blocks = int((n + m_block_size - 1) / m_block_size);
+
+    // (block, node) for every node needed in a block it is not in
+    std::vector<std::pair<int, nodeid>> copies;
+    std::vector<arcid> block_arcs(num_blocks, 0);
+    for (const input_arc &a : m_arcs) {
+      int bs = block_of(a.s), bt = block_of(a.t);
+      if (bs != bt) {
+        copies.push_back(bs < bt ? std::make_pair(bs, a.t)
+                                 : std::make_pair(bt, a.s));
+      }
+      block_arcs[std::min(bs, bt)]++;
+    }
+    std::sort(copies.begin(), copies.end());
+    copies.erase(std::unique(copies.begin(), copies.end()), copies.end());
+
+    m_blocks.clear();
+    m_copies.clear();
+    size_t next_copy = 0;
+    for (int b = 0; b < num_blocks; ++b) {
+      const nodeid own = std::min(m_block_size, n - b * m_block_size);
+      nodeid nnode = own;
+      for (; next_copy < copies.size() && copies[next_copy].first == b;
+           ++next_copy) {
+        node_copy c = {copies[next_copy].second, b, nnode++, 0, 1, 0};
+        m_copies.push_back(c);
+      }
+      m_blocks.emplace_back(new GraphImpl(nnode, block_arcs[b]));
+      m_blocks[b]->add_node(nnode);
+    }
+
+    for (const input_arc &a : m_arcs) {
+      int bs = block_of(a.s), bt = block_of(a.t);
+      nodeid s = local_id(a.s), t = local_id(a.t);
+      if (bs < bt) {
+        node_copy &c = find_copy(bs, a.t);
+        t = c.local;
+        // first steps are as large as the arcs joining the copy to its block
+        c.step = std::max(c.step, SCALE * std::max(a.fcap, a.rcap));
+      } else if (bt < bs) {
+        node_copy &c = find_copy(bt, a.s);
+        s = c.local;
+        c.step = std::max(c.step, SCALE * std::max(a.fcap, a.rcap));
+      }
+      m_blocks[std::min(bs, bt)]->add_edge(s, t, SCALE * a.fcap,
+                                           SCALE * a.rcap);
+    }
+    for (nodeid u = 0; u < n; ++u) {
+      if (m_source_cap[u] > 0 || m_sink_cap[u] > 0) {
+        m_blocks[block_of(u)]->add_tweights(
+            local_id(u), SCALE * m_source_cap[u], SCALE * m_sink_cap[u]);
+      }
+    }
+
+    // copies merged into one block keep the sum of their multipliers, those
+    // now in the block of their node are dropped
+    for (const node_copy &p : previous) {
+      if (p.lambda != 0 && block_of(p.node) != p.block) {
+        find_copy(p.block, p.node).lambda += p.lambda;
+      }
+    }
+    for (const node_copy &c : m_copies) {
+      if (c.lambda != 0) {
+        add_unary(*m_blocks[c.block], c.local, c.lambda);
+        add_unary(*m_blocks[block_of(c.node)], local_id(c.node), -c.lambda);
+      }
+    }
+  }
+
+  bool copy_segment(const node_copy &c) {
+    return m_blocks[c.block]->what_segment(c.local) == GraphImpl::SINK;
+  }
+
+  bool node_segment(nodeid u) {
+    return m_blocks[block_of(u)]->what_segment(local_id(u)) == GraphImpl::SINK;
+  }
+
+  /**
+   * @brief Solves the blocks until the copies agree with their nodes
+   *
+   * @return whether they agreed before the disagreements stalled
+   */
+  bool solve_blocks() {
+    size_t fewest = m_copies.size() + 1;
+    int fewest_iteration = 0;
+    for (int iteration = 0;; ++iteration) {
+      const bool reuse_trees = iteration > 0;
+      m_pool->parallel_for(0, m_blocks.size(), 1, [&](size_t b, unsigned) {
+        m_blocks[b]->maxflow(reuse_trees);
+      });
+      m_stats.iterations++;
+      size_t disagreements = 0;
+      for (node_copy &c : m_copies) {
+        const int x_copy = copy_segment(c), x_node = node_segment(c.node);
+        if (x_copy == x_node) {
+          continue;
+        }
+        disagreements++;
+        const int sign = x_copy - x_node;
+        if (sign != c.last_sign && c.last_sign != 0 &&
+            (c.step > 1 || !std::numeric_limits<cap>::is_integer)) {
+          c.step /= 2;
+        }
+        c.last_sign = sign;
+        // the copy pays lambda * x_copy and the node -lambda * x_node
+        const cap delta = sign * c.step;
+        c.lambda += delta;
+        add_unary(*m_blocks[c.block], c.local, delta);
+        add_unary(*m_blocks[block_of(c.node)], local_id(c.node), -delta);
+        m_blocks[c.block]->mark_node(c.local);
+        m_blocks[block_of(c.node)]->mark_node(local_id(c.node));
+      }
+      if (!disagreements) {
+        return true;
+      }
+      if (disagreements < fewest) {
+        fewest = disagreements;
+        fewest_iteration = iteration;
+      } else if (iteration - fewest_iteration >= m_stall_iterations) {
+        return false;
+      }
+    }
+  }
+
+  /**
+   * @brief Capacity of the current cut in the input graph
+   */
+  flow cut_capacity() const {
+    flow capacity = 0;
+    for (const input_arc &a : m_arcs) {
+      if (!m_what_segment[a.s] && m_what_segment[a.t]) {
+        capacity += a.fcap;
+      } else if (m_what_segment[a.s] && !m_what_segment[a.t]) {
+        capacity += a.rcap;
+      }
+    }
+    for (nodeid u = 0; u < BaseGraph::m_nnode; ++u) {
+      capacity += m_what_segment[u] ? m_source_cap[u] : m_sink_cap[u];
+    }
+    return capacity;
+  }
+
+public:
+  /**
+   * @brief GraphDualDecomposition class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   * @param num_threads number of blocks and threads solving them, 0 uses the
+   * hardware concurrency
+   * @param stall_iterations iterations without fewer disagreeing copies
+   * before neighboring blocks are merged
+   */
+  GraphDualDecomposition(nodeid nnode, arcid narc, unsigned num_threads = 0,
+                         int stall_iterations = 10)
+      : BaseGraph(nnode, narc), m_source_cap(nnode, 0), m_sink_cap(nnode, 0),
+        m_num_threads(num_threads), m_stall_iterations(stall_iterations),
+        m_block_size(1) {
+    m_arcs.reserve(narc);
+  }
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const DualDecompositionStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Adds an arc to the residual graph (also adds the residual (reverse)
+   * arc)
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    if (s != t && (fcap > 0 || rcap > 0)) {
+      input_arc a = {s, t, fcap, rcap};
+      m_arcs.push_back(a);
+    }
+  }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    m_source_cap[s] += scap;
+    m_sink_cap[s] += tcap;
+  }
+
+  /**
+   * @brief Compute the maxflow
+   *
+   * @return the maxflow
+   */
+  flow maxflow() {
+    const nodeid n = BaseGraph::m_nnode;
+    m_stats = DualDecompositionStats();
+    m_what_segment.assign(n, false);
+    if (n == 0) {
+      return 0;
+    }
+    unsigned num_threads = m_num_threads;
+    if (num_threads == 0) {
+      num_threads = std::thread::hardware_concurrency();
+    }
+    num_threads = std::max(1u, num_threads);
+    if (!m_pool || m_pool->size() != num_threads) {
+      m_pool.reset(new util::ThreadPool(num_threads));
+    }
+
+    const nodeid num_blocks = std::min<nodeid>(num_threads, n);
+    nodeid block_size = (n + num_blocks - 1) / num_blocks;
+    std::vector<node_copy> previous;
+    build_blocks(block_size, previous);
+    m_stats.blocks = m_blocks.size();
+    m_stats.copies = m_copies.size();
+    while (!solve_blocks()) {
+      // merge blocks 2b and 2b + 1 into b
+      previous.swap(m_copies);
+      for (node_copy &p : previous) {
+        p.block /= 2;
+      }
+      block_size *= 2;
+      build_blocks(block_size, previous);
+      m_stats.merges++;
+    }
+    m_stats.final_blocks = m_blocks.size();
+
+    for (nodeid u = 0; u < n; ++u) {
+      m_what_segment[u] = node_segment(u);
+    }
+    m_blocks.clear();
+    m_copies.clear();
+    return cut_capacity();
+  }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) { return m_what_segment[s]; }
+
+  size_t memory_bytes() const {
+    using detail::vector_bytes;
+    size_t bytes = vector_bytes(m_arcs) + vector_bytes(m_source_cap) +
+                   vector_bytes(m_sink_cap) + vector_bytes(m_blocks) +
+                   vector_bytes(m_copies) + vector_bytes(m_what_segment);
+    for (const std::unique_ptr<GraphImpl> &block : m_blocks) {
+      bytes += block->get_memory_bytes();
+    }
+    return bytes;
+  }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -0,0 +1,574 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_grid.h
+ *
+ * @brief Implementation of maxflow interface for grid graphs, using the BK
+ * algorithm on an implicit neighbor structure
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-08
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_GRID_H
+#define MAXFLOWLIB_MAXFLOW_GRID_H
+
+#include "maxflow.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+namespace maxflowlib {
+
+/**
+ * @brief The BK algorithm on a 2D or 3D grid where every node is joined to
+ * the same neighborhood, in the spirit of GridCut (Jamriska, Sykora and
+ * Hornung, Cache-efficient Graph Cuts on Structured Grids, CVPR 2012).
+ *
+ * Nodes are numbered x + width * (y + height * z), and arcs may only join a
+ * node to one of its neighbors. Instead of arcs with head, next and sister
+ * pointers, every node stores the residual capacity towards each neighbor
+ * in a dense array; the neighbor and the reverse arc follow from the
+ * direction. Nodes are laid out in tiles of 8x8 (2D) or 4x4x4 (3D) so the
+ * neighbors of a node are mostly in the same few cache lines, and the grid
+ * is padded by one node on every side so no neighbor is out of range.
+ *
+ * Neighborhoods are 4 or 8 connected in 2D and 6, 18 or 26 connected in 3D.
+ */
+template <typename _cap = int, typename _flow = int>
+class GridGraph : public Graph<int, int, _cap, _flow> {
+
+public:
+  typedef Graph<int, int, _cap, _flow> BaseGraph;
+  typedef typename BaseGraph::nodeid nodeid;
+  typedef typename BaseGraph::arcid arcid;
+  typedef typename BaseGraph::cap cap;
+  typedef typename BaseGraph::flow flow;
+
+private:
+  // special values of m_parent, otherwise the direction to the parent
+  static const unsigned char NO_PARENT = 255;
+  static const unsigned char TERMINAL = 254;
+  static const unsigned char ORPHAN = 253;
+  static const int INFINITE_D = INT_MAX / 2;
+
+  int m_width, m_height, m_depth;
+  int m_tile_bits[3];
+  int m_ntile[3];
+
+  // neighborhood, direction k and K - 1 - k are opposite
+  int m_ndir;
+  std::vector<int> m_offset;
+  // direction of an offset (dx + 1) + 3 * (dy + 1) + 9 * (dz + 1), or -1
+  int m_direction_of[27];
+  // index delta to the neighbor in every direction for every position in a
+  // tile
+  std::vector<int> m_delta;
+  int m_tile_size;
+
+  std::vector<cap> m_rescap;
+  std::vector<cap> m_tr_cap;
+  std::vector<unsigned char> m_parent;
+  std::vector<unsigned char> m_is_sink;
+  std::vector<int> m_ts;
+  std::vector<int> m_dist;
+  // active list, -1 if not in it, the last node points to itself
+  std::vector<int> m_next;
+  int m_queue_first[2], m_queue_last[2];
+  std::vector<int> m_orphan_front;
+  std::vector<int> m_orphan_queue;
+  int m_time;
+  flow m_flow;
+
+  int opposite(int k) const { return m_ndir - 1 - k; }
+
+  int neighbor(int i, int k) const {
+    return i + m_delta[(i & (m_tile_size - 1)) * m_ndir + k];
+  }
+
+  cap &rescap(int i, int k) { return m_rescap[size_t(i) * m_ndir + k]; }
+
+  int axis_delta(int l, int d, int axis, int local_stride,
+                 int tile_stride) const {
+    const int last = (1 << m_tile_bits[axis]) - 1;
+    if (d > 0) {
+      return l < last ? local_stride : tile_stride - last * local_stride;
+    } else if (d < 0) {
+      return l > 0 ? -local_stride : -tile_stride + last * local_stride;
+    }
+    return 0;
+  }
+
+  void init_neighborhood(int connectivity) {
+    const bool is_3d = m_depth > 1;
+    if (connectivity == 0) {
+      connectivity = is_3d ? 6 : 4;
+    }
+    if ((is_3d && connectivity != 6 && connectivity != 18 &&
+         connectivity != 26) ||
+        (!is_3d && connectivity != 4 && connectivity != 8)) {
+      throw std::invalid_argument("GridGraph: unsupported neighborhood.");
+    }
+    // offsets of the positive half, the negative half follows reversed
+    std::vector<int> half;
+    for (int dz = -1; dz <= 1; ++dz) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          const int l1 = std::abs(dx) + std::abs(dy) + std::abs(dz);
+          const bool positive =
+              dz > 0 || (dz == 0 && (dy > 0 || (dy == 0 && dx > 0)));
+          if (!positive || (!is_3d && dz != 0) ||
+              ((connectivity == 4 || connectivity == 6) && l1 > 1) ||
+              (connectivity == 18 && l1 > 2)) {
+            continue;
+          }
+          half.push_back(dx);
+          half.push_back(dy);
+          half.push_back(dz);
+        }
+      }
+    }
+    m_ndir = int(half.size() / 3) * 2;
+    m_offset.assign(3 * m_ndir, 0);
+    for (int k = 0; k < m_ndir / 2; ++k) {
+      for (int c = 0; c < 3; ++c) {
+        m_offset[3 * k + c] = half[3 * k + c];
+        m_offset[3 * (m_ndir - 1 - k) + c] = -half[3 * k + c];
+      }
+    }
+    std::fill(m_direction_of, m_direction_of + 27, -1);
+    for (int k = 0; k < m_ndir; ++k) {
+      m_direction_of[(m_offset[3 * k] + 1) + 3 * (m_offset[3 * k + 1] + 1) +
+                     9 * (m_offset[3 * k + 2] + 1)] = k;
+    }
+  }
+
+  void init_layout() {
+    const bool is_3d = m_depth > 1;
+    const int bits = is_3d ? 2 : 3;
+    const int padded[3] = {m_width + 2, m_height + 2, is_3d ? m_depth + 2 : 1};
+    for (int c = 0; c < 3; ++c) {
+      m_tile_bits[c] = (c < 2 || is_3d) ? bits : 0;
+      const int t = 1 << m_tile_bits[c];
+      m_ntile[c] = (padded[c] + t - 1) / t;
+    }
+    m_tile_size = 1 << (m_tile_bits[0] + m_tile_bits[1] + m_tile_bits[2]);
+    const int tx = 1 << m_tile_bits[0], ty = 1 << m_tile_bits[1];
+    const int tile_stride[3] = {m_tile_size, m_ntile[0] * m_tile_size,
+                                m_ntile[0] * m_ntile[1] * m_tile_size};
+    const int local_stride[3] = {1, tx, tx * ty};
+    m_delta.assign(size_t(m_tile_size) * m_ndir, 0);
+    for (int local = 0; local < m_tile_size; ++local) {
+      const int l[3] = {local & (tx - 1), (local >> m_tile_bits[0]) & (ty - 1),
+                        local >> (m_tile_bits[0] + m_tile_bits[1])};
+      for (int k = 0; k < m_ndir; ++k) {
+        int delta = 0;
+        for (int c = 0; c < 3; ++c) {
+          delta += axis_delta(l[c], m_offset[3 * k + c], c, local_stride[c],
+                              tile_stride[c]);
+        }
+        m_delta[size_t(local) * m_ndir + k] = delta;
+      }
+    }
+  }
+
+  /**
+   * @brief Index of the node at padded coordinates x, y, z
+   */
+  int index(int x, int y, int z) const {
+    const int bx = m_tile_bits[0], by = m_tile_bits[1];
+    const int tile =
+        ((z >> m_tile_bits[2]) * m_ntile[1] + (y >> by)) * m_ntile[0] +
+        (x >> bx);
+    const int local = ((z & ((1 << m_tile_bits[2]) - 1)) << (bx + by)) |
+                      ((y & ((1 << by) - 1)) << bx) | (x & ((1 << bx) - 1));
+    return tile * m_tile_size + local;
+  }
+
+  void coordinates(nodeid s, int &x, int &y, int &z) const {
+    x = s % m_width;
+    y = (s / m_width) % m_height;
+    z = s / (m_width * m_height);
+  }
+
+  int index(nodeid s) const {
+    int x, y, z;
+    coordinates(s, x, y, z);
+    return index(x + 1, y + 1, m_depth > 1 ? z + 1 : 0);
+  }
+
+  void set_active(int i) {
+    if (m_next[i] < 0) {
+      if (m_queue_last[1] >= 0) {
+        m_next[m_queue_last[1]] = i;
+      } else {
+        m_queue_first[1] = i;
+      }
+      m_queue_last[1] = i;
+      m_next[i] = i;
+    }
+  }
+
+  /**
+   * @brief Next active node, those without a parent are dropped
+   */
+  int next_active() {
+    while (true) {
+      int i = m_queue_first[0];
+      if (i < 0) {
+        m_queue_first[0] = i = m_queue_first[1];
+        m_queue_last[0] = m_queue_last[1];
+        m_queue_first[1] = m_queue_last[1] = -1;
+        if (i < 0) {
+          return -1;
+        }
+      }
+      if (m_next[i] == i) {
+        m_queue_first[0] = m_queue_last[0] = -1;
+      } else {
+        m_queue_first[0] = m_next[i];
+      }
+      m_next[i] = -1;
+      if (m_parent[i] != NO_PARENT) {
+        return i;
+      }
+    }
+  }
+
+  void set_orphan_front(int i) {
+    m_parent[i] = ORPHAN;
+    m_orphan_front.push_back(i);
+  }
+
+  void set_orphan_rear(int i) {
+    m_parent[i] = ORPHAN;
+    m_orphan_queue.push_back(i);
+  }
+
+  void maxflow_init() {
+    m_queue_first[0] = m_queue_last[0] = -1;
+    m_queue_first[1] = m_queue_last[1] = -1;
+    m_orphan_front.clear();
+    m_orphan_queue.clear();
+    m_time = 0;
+    const int n = int(m_tr_cap.size());
+    for (int i = 0; i < n; ++i) {
+      m_next[i] = -1;
+      m_ts[i] = m_time;
+      if (m_tr_cap[i] != 0) {
+        m_is_sink[i] = m_tr_cap[i] < 0;
+        m_parent[i] = TERMINAL;
+        set_active(i);
+        m_dist[i] = 1;
+      } else {
+        m_parent[i] = NO_PARENT;
+      }
+    }
+  }
+
+  /**
+   * @brief Pushes the bottleneck along the path through the arc from u in
+   * direction k, u is in the source tree and its neighbor in the sink tree
+   */
+  void augment(int u, int k) {
+    const int v = neighbor(u, k);
+    cap bottleneck = rescap(u, k);
+    int i;
+    for (i = u; m_parent[i] != TERMINAL;) {
+      const int p = m_parent[i], j = neighbor(i, p);
+      bottleneck = std::min(bottleneck, rescap(j, opposite(p)));
+      i = j;
+    }
+    bottleneck = std::min(bottleneck, m_tr_cap[i]);
+    for (i = v; m_parent[i] != TERMINAL;) {
+      const int p = m_parent[i];
+      bottleneck = std::min(bottleneck, rescap(i, p));
+      i = neighbor(i, p);
+    }
+    bottleneck = std::min(bottleneck, cap(-m_tr_cap[i]));
+
+    rescap(v, opposite(k)) += bottleneck;
+    rescap(u, k) -= bottleneck;
+    for (i = u; m_parent[i] != TERMINAL;) {
+      const int p = m_parent[i], j = neighbor(i, p);
+      rescap(i, p) += bottleneck;
+      if (!(rescap(j, opposite(p)) -= bottleneck)) {
+        set_orphan_front(i);
+      }
+      i = j;
+    }
+    if (!(m_tr_cap[i] -= bottleneck)) {
+      set_orphan_front(i);
+    }
+    for (i = v; m_parent[i] != TERMINAL;) {
+      const int p = m_parent[i], j = neighbor(i, p);
+      rescap(j, opposite(p)) += bottleneck;
+      if (!(rescap(i, p) -= bottleneck)) {
+        set_orphan_front(i);
+      }
+      i = j;
+    }
+    if (!(m_tr_cap[i] += bottleneck)) {
+      set_orphan_front(i);
+    }
+    m_flow += bottleneck;
+  }
+
+  /**
+   * @brief Distance of j to its terminal through the tree, or INFINITE_D if
+   * it hangs off an orphan
+   */
+  int distance_to_terminal(int j) {
+    int d = 0;
+    while (true) {
+      if (m_ts[j] == m_time) {
+        return d + m_dist[j];
+      }
+      const int p = m_parent[j];
+      d++;
+      if (p == TERMINAL) {
+        m_ts[j] = m_time;
+        m_dist[j] = 1;
+        return d;
+      }
+      if (p == ORPHAN) {
+        return INFINITE_D;
+      }
+      j = neighbor(j, p);
+    }
+  }
+
+  void process_orphan(int i) {
+    const bool is_sink = m_is_sink[i];
+    int k_min = -1, d_min = INFINITE_D;
+    // trying to find a new parent
+    for (int k = 0; k < m_ndir; ++k) {
+      const int j = neighbor(i, k);
+      const cap r = is_sink ? rescap(i, k) : rescap(j, opposite(k));
+      if (!r || m_is_sink[j] != is_sink || m_parent[j] == NO_PARENT) {
+        continue;
+      }
+      int d = distance_to_terminal(j);
+      if (d < INFINITE_D) {
+        if (d < d_min) {
+          k_min = k;
+          d_min = d;
+        }
+        // set marks along the path
+        for (int x = j; m_ts[x] != m_time; x = neighbor(x, m_parent[x])) {
+          m_ts[x] = m_time;
+          m_dist[x] = d--;
+        }
+      }
+    }
+    if (k_min >= 0) {
+      m_parent[i] = (unsigned char)k_min;
+      m_ts[i] = m_time;
+      m_dist[i] = d_min + 1;
+      return;
+    }
+    // no parent is found, process neighbors
+    m_parent[i] = NO_PARENT;
+    for (int k = 0; k < m_ndir; ++k) {
+      const int j = neighbor(i, k);
+      const int p = m_parent[j];
+      if (m_is_sink[j] != is_sink || p == NO_PARENT) {
+        continue;
+      }
+      if (is_sink ? rescap(i, k) : rescap(j, opposite(k))) {
+        set_active(j);
+      }
+      if (p == opposite(k)) {
+        set_orphan_rear(j);
+      }
+    }
+  }
+
+  void adopt_orphans() {
+    while (!m_orphan_front.empty()) {
+      m_orphan_queue.push_back(m_orphan_front.back());
+      m_orphan_front.pop_back();
+      for (size_t q = 0; q < m_orphan_queue.size(); ++q) {
+        process_orphan(m_orphan_queue[q]);
+      }
+      m_orphan_queue.clear();
+    }
+  }
+
+  /**
+   * @brief Grows the tree of i by one level
+   *
+   * @return the node in the source tree and the direction of an arc into
+   * the sink tree, or -1
+   */
+  int grow(int i, int &k_middle) {
+    const bool is_sink = m_is_sink[i];
+    for (int k = 0; k < m_ndir; ++k) {
+      const int j = neighbor(i, k);
+      if (!(is_sink ? rescap(j, opposite(k)) : rescap(i, k))) {
+        continue;
+      }
+      if (m_parent[j] == NO_PARENT) {
+        m_is_sink[j] = is_sink;
+        m_parent[j] = (unsigned char)opposite(k);
+        m_ts[j] = m_ts[i];
+        m_dist[j] = m_dist[i] + 1;
+        set_active(j);
+      } else if (m_is_sink[j] != is_sink) {
+        k_middle = is_sink ? opposite(k) : k;
+        return is_sink ? j : i;
+      } else if (m_ts[j] <= m_ts[i] && m_dist[j] > m_dist[i]) {
+        // heuristic - trying to make the distance from j to its terminal
+        // shorter
+        m_parent[j] = (unsigned char)opposite(k);
+        m_ts[j] = m_ts[i];
+        m_dist[j] = m_dist[i] + 1;
+      }
+    }
+    return -1;
+  }
+
+public:
+  /**
+   * @brief GridGraph class constructor
+   *
+   * @param width number of nodes along x
+   * @param height number of nodes along y
+   * @param depth number of nodes along z, 1 for a 2D grid
+   * @param connectivity size of the neighborhood, 4 or 8 in 2D and 6, 18 or
+   * 26 in 3D, 0 picks 4 or 6
+   */
+  GridGraph(int width, int height, int depth = 1, int connectivity = 0)
+      : BaseGraph(width * height * depth, 0), m_width(width),
+        m_height(height), m_depth(depth), m_time(0), m_flow(0) {
+    init_neighborhood(connectivity);
+    init_layout();
+    BaseGraph::m_narc = BaseGraph::m_nnode * (m_ndir / 2);
+    const size_t n = size_t(m_ntile[0]) * m_ntile[1] * m_ntile[2] *
+                     m_tile_size;
+    m_rescap.assign(n * m_ndir, 0);
+    m_tr_cap.assign(n, 0);
+    m_parent.assign(n, (unsigned char)NO_PARENT);
+    m_is_sink.assign(n, 0);
+    m_ts.assign(n, 0);
+    m_dist.assign(n, 0);
+    m_next.assign(n, -1);
+  }
+
+  /**
+   * @brief Number of directions in the neighborhood
+   */
+  int num_directions() const { return m_ndir; }
+
+  /**
+   * @brief Adds an arc to the residual graph (also adds the residual (reverse)
+   * arc), capacities of repeated calls are summed
+   *
+   * @param s source node
+   * @param t target node, a neighbor of s
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    int sx, sy, sz, tx, ty, tz;
+    coordinates(s, sx, sy, sz);
+    coordinates(t, tx, ty, tz);
+    const int dx = tx - sx, dy = ty - sy, dz = tz - sz;
+    const int k = (std::abs(dx) > 1 || std::abs(dy) > 1 || std::abs(dz) > 1)
+                      ? -1
+                      : m_direction_of[(dx + 1) + 3 * (dy + 1) + 9 * (dz + 1)];
+    if (k < 0) {
+      throw std::invalid_argument(
+          "GridGraph: add_arc called on nodes that are not neighbors.");
+    }
+    const int i = index(s), j = index(t);
+    rescap(i, k) += fcap;
+    rescap(j, opposite(k)) += rcap;
+  }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    const int i = index(s);
+    if (m_tr_cap[i] > 0) {
+      scap += m_tr_cap[i];
+    } else {
+      tcap -= m_tr_cap[i];
+    }
+    m_flow += std::min(scap, tcap);
+    m_tr_cap[i] = scap - tcap;
+  }
+
+  /**
+   * @brief Compute the maxflow
+   *
+   * @return the maxflow
+   */
+  flow maxflow() {
+    maxflow_init();
+    int current_node = -1;
+    while (true) {
+      int i = current_node;
+      if (i >= 0) {
+        m_next[i] = -1; // remove active flag
+        if (m_parent[i] == NO_PARENT) {
+          i = -1;
+        }
+      }
+      if (i < 0 && (i = next_active()) < 0) {
+        break;
+      }
+      int k_middle = -1;
+      const int u = grow(i, k_middle);
+      m_time++;
+      if (u >= 0) {
+        m_next[i] = i; // set active flag
+        current_node = i;
+        augment(u, k_middle);
+        adopt_orphans();
+      } else {
+        current_node = -1;
+      }
+    }
+    return m_flow;
+  }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) {
+    const int i = index(s);
+    return m_parent[i] != NO_PARENT && m_is_sink[i];
+  }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -50,19 +50,58 @@ private:
   bool m_inited_graph;
   bool m_pseudoflow_computed;
   bool m_use_pseudoflow_for_maxflow;
+  // maxflow_from_pseudoflow recovered the arc flows
+  bool m_flow_recovered;
+  // flow of min(scap, tcap) through every node, HPF only keeps the difference
+  flow m_terminal_flow;
+
+  /**
+   * @brief The graph owning HPF's global arrays, which are freed with it
+   */
+  static GraphHPF *&owner() {
+    static GraphHPF *graph = NULL;
+    return graph;
+  }
 
 public:
   /**
    * @brief GraphHPF class constructor
    *
    * @param nnode number of nodes in the graph
-   * @param narc  number of arcs in the graph
+   * @param narc  number of arcs in the graph, more may be added
    */
   GraphHPF(nodeid nnode, arcid narc, bool use_pseudoflow_for_maxflow = false)
       : BaseGraph(nnode, narc), m_inited_graph(false),
         m_pseudoflow_computed(false),
-        m_use_pseudoflow_for_maxflow(use_pseudoflow_for_maxflow) {
+        m_use_pseudoflow_for_maxflow(use_pseudoflow_for_maxflow),
+        m_flow_recovered(false), m_terminal_flow(0) {
     allocateGraph(nnode, narc);
+    owner() = this;
+  }
+
+  ~GraphHPF() {
+    if (owner() == this) {
+      ::freeGraph();
+      owner() = NULL;
+    }
+  }
+
+  /**
+   * @brief Clears the graph so it can be filled again, reusing its memory
+   * when it is large enough
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   */
+  void reset(nodeid nnode, arcid narc) {
+    m_nnode = nnode;
+    m_narc = narc;
+    m_inited_graph = false;
+    m_pseudoflow_computed = false;
+    m_flow_recovered = false;
+    m_terminal_flow = 0;
+    ::resetGraph(nnode, narc);
+    owner() = this;
   }
 
   /**
@@ -93,16 +132,24 @@ public:
       throw std::logic_error("Initialized HPF graph: set_tweights called.");
     }
     ::set_tweights(s, scap, tcap);
+    m_terminal_flow += scap < tcap ? scap : tcap;
   }
 
-  flow pseudoflow() {
+  /**
+   * @brief Builds the HPF adjacency lists from the added arcs
+   */
+  void init_graph() {
     if (!m_inited_graph) {
       ::initializeGraph();
       m_inited_graph = true;
     }
+  }
+
+  flow pseudoflow() {
+    init_graph();
     flow mincut = ::pseudoflow();
     m_pseudoflow_computed = true;
-    return mincut;
+    return m_terminal_flow + mincut;
   }
 
   /**
@@ -117,7 +164,40 @@ public:
     if (!m_pseudoflow_computed) {
       pseudoflow();
     }
-    return ::maxflow_from_pseudoflow();
+    m_flow_recovered = true;
+    return m_terminal_flow + ::maxflow_from_pseudoflow();
+  }
+
+  /**
+   * @brief Compute the maxflow, stopping early once options expire or the
+   * progress callback returns false, bounds come from the pseudoflow and the
+   * nodes lifted to the source side. An interrupted solve is resumed by the
+   * next maxflow call.
+   *
+   * @return the maxflow, or a lower bound on it when interrupted()
+   */
+  flow maxflow_until(const SolveOptions &options) {
+    init_graph();
+    m_interrupted = false;
+    if (!m_pseudoflow_computed) {
+      SolveMonitor monitor(options, [this](double &lower, double &upper) {
+        lower = double(m_terminal_flow + ::flowLowerBound());
+        upper = double(m_terminal_flow + ::cutUpperBound());
+      });
+      ::setInterrupt(&SolveMonitor::check, &monitor);
+      flow mincut = ::pseudoflow();
+      ::setInterrupt(NULL, NULL);
+      if (::isInterrupted()) {
+        m_interrupted = true;
+        return m_terminal_flow + ::flowLowerBound();
+      }
+      m_pseudoflow_computed = true;
+      if (m_use_pseudoflow_for_maxflow) {
+        return m_terminal_flow + mincut;
+      }
+    }
+    m_flow_recovered = true;
+    return m_terminal_flow + ::maxflow_from_pseudoflow();
   }
 
   /**
@@ -128,6 +208,24 @@ public:
    * @return either 0 - indicates source segment or 1 - indicates sink segment
    */
   bool what_segment(nodeid s) { return ::what_segment(s); }
+
+  size_t memory_bytes() const { return size_t(::memoryBytes()); }
+
+  /**
+   * @brief Checks the flow recovered by maxflow with HPF's own optimality
+   * check, a pseudoflow alone is not checked
+   */
+  FlowCheck check_flow(std::string &error) {
+    if (!m_flow_recovered) {
+      return FLOW_UNCHECKED;
+    }
+    if (!::checkOptimality()) {
+      error = "HPF flow violates a capacity or flow conservation, or does "
+              "not equal its cut";
+      return FLOW_INVALID;
+    }
+    return FLOW_VALID;
+  }
 };
 
 } // namespace maxflowlib
@@ -51,16 +51,32 @@ public:
 
 private:
   GraphImpl m_graph;
+  bool m_inited_graph;
 
 public:
   /**
    * @brief GraphIBFS class constructor
    *
    * @param nnode number of nodes in the graph
-   * @param narc  number of arcs in the graph
+   * @param narc  number of arcs in the graph, more may be added
    */
   GraphIBFS(nodeid nnode, arcid narc)
-      : BaseGraph(nnode, narc), m_graph(::IBFSGraph::IB_INIT_FAST) {
+      : BaseGraph(nnode, narc), m_graph(::IBFSGraph::IB_INIT_FAST),
+        m_inited_graph(false) {
+    m_graph.initSize(nnode, narc);
+  }
+
+  /**
+   * @brief Clears the graph so it can be filled again, reusing its memory
+   * when it is large enough
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   */
+  void reset(nodeid nnode, arcid narc) {
+    m_nnode = nnode;
+    m_narc = narc;
+    m_inited_graph = false;
     m_graph.initSize(nnode, narc);
   }
 
@@ -88,16 +104,44 @@ public:
     m_graph.addNode(s, scap, tcap);
   }
 
+  /**
+   * @brief Lays the added arcs out in IBFS arrays
+   */
+  void init_graph() {
+    if (!m_inited_graph) {
+      m_graph.initGraph();
+      m_inited_graph = true;
+    }
+  }
+
   /**
    * @brief Compute the maxflow
    *
    * @return the maxflow
    */
   flow maxflow() {
-    m_graph.initGraph();
+    init_graph();
     return m_graph.computeMaxFlow();
   }
 
+  /**
+   * @brief Compute the maxflow, stopping early once options expire or the
+   * progress callback returns false, bounds come from the S and T trees
+   *
+   * @return the maxflow, or a lower bound on it when interrupted()
+   */
+  flow maxflow_until(const SolveOptions &options) {
+    SolveMonitor monitor(options, [this](double &lower, double &upper) {
+      lower = double(m_graph.getFlow());
+      upper = double(m_graph.computeCutCapacity());
+    });
+    m_graph.setInterrupt(&SolveMonitor::check, &monitor);
+    flow f = maxflow();
+    m_graph.setInterrupt(NULL, NULL);
+    m_interrupted = m_graph.isInterrupted();
+    return f;
+  }
+
   /**
    * @brief Return which segment a node belongs to in the minimum cut
    *
@@ -106,6 +150,8 @@ public:
    * @return either 0 - indicates source segment or 1 - indicates sink segment
    */
   bool what_segment(nodeid s) { return m_graph.what_segment(s); }
+
+  size_t memory_bytes() const { return size_t(m_graph.memoryBytes()); }
 };
 
 } // namespace maxflowlib
@@ -0,0 +1,641 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_planar.h
+ *
+ * @brief Implementation of maxflow interface for 2D 4-connected grids by a
+ * shortest path in the planar dual, falling back to any of the directed
+ * maxflow implementations.
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-09
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_PLANAR_H
+#define MAXFLOWLIB_MAXFLOW_PLANAR_H
+
+#include "maxflow.h"
+#include "maxflow_undirected.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "util/timer.h"
+
+namespace maxflowlib {
+
+/**
+ * @brief What the last GraphPlanar::maxflow call did
+ */
+struct PlanarStats {
+  // whether the cut came from the planar dual, otherwise from the engine
+  bool planar;
+  // why the engine was used, null if it was not
+  const char *fallback_reason;
+  size_t faces;
+  double solve_seconds;
+
+  PlanarStats()
+      : planar(false), fallback_reason(nullptr), faces(0), solve_seconds(0) {}
+};
+
+/**
+ * @brief Minimum cut of a width x height 4-connected grid, nodes numbered
+ * x + width * y, as a shortest path in its planar dual (Hassin, Maximum
+ * flow in (s,t) planar networks, 1981).
+ *
+ * Opposing source and sink capacities of a node are cancelled first. The
+ * graph with both terminals is then planar when only boundary nodes keep a
+ * terminal arc and, going around the boundary, the source nodes and the sink
+ * nodes form two runs that do not interleave. Both terminals then sit in the
+ * outer face, which a virtual source-sink edge splits in two; the minimum
+ * cut is the shortest dual path between those two faces, each dual arc
+ * costing the capacity of the primal arc it crosses from the source side.
+ *
+ * Otherwise, or when an arc does not join grid neighbors, the graph is
+ * solved by GraphMaxflow. Grids with interior terminal arcs, such as most
+ * labeling problems, always take that path.
+ */
+template <typename GraphMaxflow>
+class GraphPlanar
+    : public Graph<typename GraphMaxflow::nodeid, typename GraphMaxflow::arcid,
+                   typename GraphMaxflow::cap, typename GraphMaxflow::flow> {
+public:
+  typedef typename GraphMaxflow::nodeid nodeid;
+  typedef typename GraphMaxflow::arcid arcid;
+  typedef typename GraphMaxflow::cap cap;
+  typedef typename GraphMaxflow::flow flow;
+  typedef Graph<nodeid, arcid, cap, flow> BaseGraph;
+
+private:
+  enum { NO_LABEL = 0, SOURCE_LABEL = 1, SINK_LABEL = 2 };
+  // the two halves of the outer face, split by the virtual source-sink edge
+  enum { FIRST_FACE = 0, LAST_FACE = 1 };
+
+  struct input_arc {
+    nodeid s, t;
+    cap fcap, rcap;
+  };
+
+  struct dual_arc {
+    nodeid head;
+    flow cost;
+    // the primal edge crossed
+    size_t edge;
+  };
+
+  int m_width, m_height;
+  std::vector<input_arc> m_arcs;
+  std::vector<cap> m_source_cap;
+  std::vector<cap> m_sink_cap;
+  const char *m_not_planar;
+
+  // capacities of (x, y) -> (x + 1, y) and back, (x, y) -> (x, y + 1) and
+  // back
+  std::vector<cap> m_right_cap, m_left_cap;
+  std::vector<cap> m_down_cap, m_up_cap;
+
+  // boundary nodes clockwise from (0, 0) and their terminal label
+  std::vector<nodeid> m_boundary;
+  std::vector<unsigned char> m_label;
+  // outer face outside every boundary edge, and on either side of the
+  // terminal edge of every boundary node
+  std::vector<nodeid> m_boundary_face;
+  std::vector<nodeid> m_face_before, m_face_after;
+
+  std::vector<size_t> m_dual_first;
+  std::vector<dual_arc> m_dual_arcs;
+
+  PlanarStats m_stats;
+  std::vector<bool> m_what_segment;
+
+  nodeid node(int x, int y) const { return nodeid(x + m_width * y); }
+
+  size_t horizontal_edge(int x, int y) const {
+    return size_t(x) + size_t(m_width - 1) * y;
+  }
+
+  size_t vertical_edge(int x, int y) const {
+    return size_t(m_width - 1) * m_height + x + size_t(m_width) * y;
+  }
+
+  size_t terminal_edge(size_t pos) const {
+    return size_t(m_width - 1) * m_height + size_t(m_width) * (m_height - 1) +
+           pos;
+  }
+
+  nodeid cell_face(int cx, int cy) const {
+    return nodeid(2 + cx + (m_width - 1) * cy);
+  }
+
+  /**
+   * @brief Position of boundary node (x, y) in the clockwise walk
+   */
+  size_t boundary_position(int x, int y) const {
+    const int w = m_width - 1, h = m_height - 1;
+    if (y == 0) {
+      return x;
+    } else if (x == w) {
+      return w + y;
+    } else if (y == h) {
+      return w + h + (w - x);
+    }
+    return 2 * w + h + (h - y);
+  }
+
+  void build_boundary() {
+    m_boundary.clear();
+    for (int x = 0; x < m_width; ++x) {
+      m_boundary.push_back(node(x, 0));
+    }
+    for (int y = 1; y < m_height; ++y) {
+      m_boundary.push_back(node(m_width - 1, y));
+    }
+    for (int x = m_width - 2; x >= 0; --x) {
+      m_boundary.push_back(node(x, m_height - 1));
+    }
+    for (int y = m_height - 2; y >= 1; --y) {
+      m_boundary.push_back(node(0, y));
+    }
+  }
+
+  /**
+   * @brief Checks that only boundary nodes keep terminal arcs and that the
+   * source and sink runs do not interleave, then numbers the outer faces
+   *
+   * @return why the graph is not planar, or null
+   */
+  const char *label_boundary() {
+    const size_t nboundary = m_boundary.size();
+    std::vector<bool> on_boundary(BaseGraph::m_nnode, false);
+    m_label.assign(nboundary, NO_LABEL);
+    for (size_t pos = 0; pos < nboundary; ++pos) {
+      nodeid u = m_boundary[pos];
+      on_boundary[u] = true;
+      if (m_source_cap[u] > 0) {
+        m_label[pos] = SOURCE_LABEL;
+      } else if (m_sink_cap[u] > 0) {
+        m_label[pos] = SINK_LABEL;
+      }
+    }
+    for (nodeid u = 0; u < BaseGraph::m_nnode; ++u) {
+      if (!on_boundary[u] && (m_source_cap[u] > 0 || m_sink_cap[u] > 0)) {
+        return "terminal arc at an interior node";
+      }
+    }
+
+    // the walk starts at the first source node after a sink node
+    size_t start = nboundary, changes = 0;
+    unsigned char last = NO_LABEL;
+    for (size_t k = 0; k < 2 * nboundary; ++k) {
+      const size_t pos = k % nboundary;
+      if (m_label[pos] == NO_LABEL) {
+        continue;
+      }
+      if (last != NO_LABEL && m_label[pos] != last && k >= nboundary) {
+        changes++;
+        if (m_label[pos] == SOURCE_LABEL) {
+          start = pos;
+        }
+      }
+      last = m_label[pos];
+    }
+    if (changes == 0) {
+      // at most one terminal keeps arcs, solve_planar needs no faces
+      m_stats.faces = 0;
+      return nullptr;
+    }
+    if (changes != 2) {
+      return "source and sink arcs interleave along the boundary";
+    }
+
+    nodeid nface = cell_face(0, m_height - 1);
+    m_boundary_face.assign(nboundary, 0);
+    m_face_before.assign(nboundary, 0);
+    m_face_after.assign(nboundary, 0);
+    nodeid face = FIRST_FACE;
+    for (size_t k = 0; k < nboundary; ++k) {
+      const size_t pos = (start + k) % nboundary;
+      if (m_label[pos] != NO_LABEL) {
+        // the next labeled node along the walk
+        size_t next = (pos + 1) % nboundary;
+        while (m_label[next] == NO_LABEL) {
+          next = (next + 1) % nboundary;
+        }
+        m_face_before[pos] = face;
+        if (m_label[next] == m_label[pos] && next != start) {
+          face = nface++;
+        } else {
+          face = m_label[pos] == SOURCE_LABEL ? LAST_FACE : FIRST_FACE;
+        }
+        m_face_after[pos] = face;
+      }
+      m_boundary_face[pos] = face;
+    }
+    m_stats.faces = size_t(nface);
+    return nullptr;
+  }
+
+  void add_crossing(std::vector<std::pair<nodeid, dual_arc>> &arcs, nodeid a,
+                    nodeid b, flow ab, flow ba, size_t edge) {
+    dual_arc forward = {b, ab, edge}, backward = {a, ba, edge};
+    arcs.push_back(std::make_pair(a, forward));
+    arcs.push_back(std::make_pair(b, backward));
+  }
+
+  /**
+   * @brief Builds the dual, crossing an edge costs the capacity from the node
+   * on the left of the crossing (the source side) to the one on the right
+   */
+  void build_dual() {
+    std::vector<std::pair<nodeid, dual_arc>> arcs;
+    const int w = m_width, h = m_height;
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x + 1 < w; ++x) {
+        // going down the left of the crossing is (x + 1, y)
+        const size_t e = horizontal_edge(x, y);
+        nodeid up = y == 0 ? m_boundary_face[x] : cell_face(x, y - 1);
+        nodeid down = y == h - 1
+                          ? m_boundary_face[boundary_position(x + 1, y)]
+                          : cell_face(x, y);
+        add_crossing(arcs, up, down, m_left_cap[e], m_right_cap[e], e);
+      }
+    }
+    for (int y = 0; y + 1 < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        // going right the left of the crossing is (x, y)
+        const size_t e = vertical_edge(x, y) - vertical_edge(0, 0);
+        nodeid left = x == 0 ? m_boundary_face[boundary_position(0, y + 1)]
+                             : cell_face(x - 1, y);
+        nodeid right = x == w - 1 ? m_boundary_face[boundary_position(x, y)]
+                                  : cell_face(x, y);
+        add_crossing(arcs, left, right, m_down_cap[e], m_up_cap[e],
+                     vertical_edge(x, y));
+      }
+    }
+    // clockwise across a terminal edge its terminal is on the left
+    for (size_t pos = 0; pos < m_boundary.size(); ++pos) {
+      const nodeid u = m_boundary[pos];
+      if (m_label[pos] == SOURCE_LABEL) {
+        add_crossing(arcs, m_face_before[pos], m_face_after[pos],
+                     m_source_cap[u], 0, terminal_edge(pos));
+      } else if (m_label[pos] == SINK_LABEL) {
+        add_crossing(arcs, m_face_before[pos], m_face_after[pos], 0,
+                     m_sink_cap[u], terminal_edge(pos));
+      }
+    }
+
+    const size_t nface = m_stats.faces;
+    m_dual_first.assign(nface + 1, 0);
+    for (const std::pair<nodeid, dual_arc> &a : arcs) {
+      m_dual_first[a.first + 1]++;
+    }
+    for (size_t f = 0; f < nface; ++f) {
+      m_dual_first[f + 1] += m_dual_first[f];
+    }
+    m_dual_arcs.resize(arcs.size());
+    std::vector<size_t> next(m_dual_first.begin(), m_dual_first.end() - 1);
+    for (const std::pair<nodeid, dual_arc> &a : arcs) {
+      m_dual_arcs[next[a.first]++] = a.second;
+    }
+  }
+
+  /**
+   * @brief Dijkstra from the first to the last outer face
+   *
+   * @return the primal edges on the shortest path and its length
+   */
+  flow shortest_path(std::vector<bool> &crossed) {
+    typedef std::pair<flow, nodeid> entry;
+    const size_t nface = m_stats.faces;
+    std::vector<flow> dist(nface, 0);
+    std::vector<bool> reached(nface, false), done(nface, false);
+    std::vector<const dual_arc *> pred(nface, nullptr);
+    std::vector<nodeid> pred_face(nface, 0);
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+    reached[FIRST_FACE] = true;
+    queue.push(entry(0, FIRST_FACE));
+    while (!queue.empty()) {
+      const entry top = queue.top();
+      queue.pop();
+      const nodeid f = top.second;
+      if (done[f]) {
+        continue;
+      }
+      done[f] = true;
+      if (f == LAST_FACE) {
+        break;
+      }
+      for (size_t i = m_dual_first[f]; i < m_dual_first[f + 1]; ++i) {
+        const dual_arc &a = m_dual_arcs[i];
+        const flow d = top.first + a.cost;
+        if (!reached[a.head] || d < dist[a.head]) {
+          reached[a.head] = true;
+          dist[a.head] = d;
+          pred[a.head] = &a;
+          pred_face[a.head] = f;
+          queue.push(entry(d, a.head));
+        }
+      }
+    }
+    for (nodeid f = LAST_FACE; f != FIRST_FACE; f = pred_face[f]) {
+      crossed[pred[f]->edge] = true;
+    }
+    return dist[LAST_FACE];
+  }
+
+  /**
+   * @brief The source side is what the source reaches without crossing the
+   * path
+   */
+  void flood_source_side(const std::vector<bool> &crossed) {
+    std::vector<nodeid> stack;
+    for (size_t pos = 0; pos < m_boundary.size(); ++pos) {
+      const nodeid u = m_boundary[pos];
+      if (m_label[pos] == SOURCE_LABEL && !crossed[terminal_edge(pos)] &&
+          m_what_segment[u]) {
+        m_what_segment[u] = false;
+        stack.push_back(u);
+      }
+    }
+    auto visit = [&](int x, int y, size_t e) {
+      const nodeid v = node(x, y);
+      if (!crossed[e] && m_what_segment[v]) {
+        m_what_segment[v] = false;
+        stack.push_back(v);
+      }
+    };
+    while (!stack.empty()) {
+      const nodeid u = stack.back();
+      stack.pop_back();
+      const int x = int(u % m_width), y = int(u / m_width);
+      if (x + 1 < m_width) {
+        visit(x + 1, y, horizontal_edge(x, y));
+      }
+      if (x > 0) {
+        visit(x - 1, y, horizontal_edge(x - 1, y));
+      }
+      if (y + 1 < m_height) {
+        visit(x, y + 1, vertical_edge(x, y));
+      }
+      if (y > 0) {
+        visit(x, y - 1, vertical_edge(x, y - 1));
+      }
+    }
+  }
+
+  flow solve_planar(flow constant) {
+    m_stats.planar = true;
+    m_what_segment.assign(BaseGraph::m_nnode, true);
+    bool has_source = false, has_sink = false;
+    for (unsigned char label : m_label) {
+      has_source |= label == SOURCE_LABEL;
+      has_sink |= label == SINK_LABEL;
+    }
+    if (!has_source || !has_sink) {
+      // no flow, everything on the side of the terminal with arcs
+      m_what_segment.assign(BaseGraph::m_nnode, !has_source);
+      return constant;
+    }
+    build_dual();
+    std::vector<bool> crossed(terminal_edge(m_boundary.size()), false);
+    const flow f = shortest_path(crossed);
+    flood_source_side(crossed);
+    m_dual_arcs.clear();
+    return constant + f;
+  }
+
+  flow solve_engine() {
+    GraphMaxflow graph(BaseGraph::m_nnode, arcid(m_arcs.size()));
+    for (const input_arc &a : m_arcs) {
+      graph.add_arc(a.s, a.t, a.fcap, a.rcap);
+    }
+    for (nodeid u = 0; u < BaseGraph::m_nnode; ++u) {
+      if (m_source_cap[u] > 0 || m_sink_cap[u] > 0) {
+        graph.set_tweights(u, m_source_cap[u], m_sink_cap[u]);
+      }
+    }
+    const flow f = graph.maxflow();
+    m_what_segment.resize(BaseGraph::m_nnode);
+    for (nodeid u = 0; u < BaseGraph::m_nnode; ++u) {
+      m_what_segment[u] = graph.what_segment(u);
+    }
+    return f;
+  }
+
+public:
+  /**
+   * @brief GraphPlanar class constructor
+   *
+   * @param width number of nodes along x
+   * @param height number of nodes along y
+   */
+  GraphPlanar(int width, int height)
+      : BaseGraph(nodeid(width * height),
+                  arcid((width - 1) * height + width * (height - 1))),
+        m_width(width), m_height(height),
+        m_source_cap(size_t(width) * height, 0),
+        m_sink_cap(size_t(width) * height, 0), m_not_planar(nullptr) {
+    if (width < 2 || height < 2) {
+      m_not_planar = "grid narrower than 2 nodes";
+      return;
+    }
+    const size_t nedge = size_t(width - 1) * height;
+    m_right_cap.assign(nedge, 0);
+    m_left_cap.assign(nedge, 0);
+    const size_t nvertical = size_t(width) * (height - 1);
+    m_down_cap.assign(nvertical, 0);
+    m_up_cap.assign(nvertical, 0);
+    build_boundary();
+  }
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const PlanarStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Adds an arc to the residual graph (also adds the residual (reverse)
+   * arc), capacities of repeated calls are summed
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    input_arc a = {s, t, fcap, rcap};
+    m_arcs.push_back(a);
+    if (m_not_planar) {
+      return;
+    }
+    if (t < s) {
+      std::swap(s, t);
+      std::swap(fcap, rcap);
+    }
+    const int x = int(s % m_width), y = int(s / m_width);
+    if (t == s + 1 && x + 1 < m_width) {
+      m_right_cap[horizontal_edge(x, y)] += fcap;
+      m_left_cap[horizontal_edge(x, y)] += rcap;
+    } else if (t == s + m_width) {
+      const size_t e = vertical_edge(x, y) - vertical_edge(0, 0);
+      m_down_cap[e] += fcap;
+      m_up_cap[e] += rcap;
+    } else if (s != t) {
+      m_not_planar = "arc between nodes that are not grid neighbors";
+    }
+  }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    m_source_cap[s] += scap;
+    m_sink_cap[s] += tcap;
+  }
+
+  /**
+   * @brief Compute the maxflow
+   *
+   * @return the maxflow
+   */
+  flow maxflow() {
+    m_stats = PlanarStats();
+    util::Timer timer;
+    timer.tic();
+    const char *reason = m_not_planar;
+    flow f;
+    if (!reason) {
+      // cancel opposing terminal capacities, the engine handles them itself
+      flow constant = 0;
+      std::vector<cap> source_cap(m_source_cap), sink_cap(m_sink_cap);
+      for (nodeid u = 0; u < BaseGraph::m_nnode; ++u) {
+        cap through = std::min(m_source_cap[u], m_sink_cap[u]);
+        constant += through;
+        m_source_cap[u] -= through;
+        m_sink_cap[u] -= through;
+      }
+      reason = label_boundary();
+      if (!reason) {
+        f = solve_planar(constant);
+      }
+      m_source_cap.swap(source_cap);
+      m_sink_cap.swap(sink_cap);
+    }
+    if (reason) {
+      m_stats.fallback_reason = reason;
+      f = solve_engine();
+    }
+    timer.toc();
+    m_stats.solve_seconds = timer.elapsed_seconds();
+    return f;
+  }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) { return m_what_segment[s]; }
+};
+
+/**
+ * @brief Undirected interface to GraphPlanar
+ */
+template <typename GraphMaxflow>
+class UndirectedGraphPlanar
+    : public UndirectedGraph<
+          typename GraphMaxflow::nodeid, typename GraphMaxflow::arcid,
+          typename GraphMaxflow::cap, typename GraphMaxflow::flow> {
+public:
+  typedef typename GraphMaxflow::nodeid nodeid;
+  typedef typename GraphMaxflow::arcid arcid;
+  typedef typename GraphMaxflow::cap cap;
+  typedef typename GraphMaxflow::flow flow;
+  typedef UndirectedGraph<nodeid, arcid, cap, flow> BaseGraph;
+
+private:
+  GraphPlanar<GraphMaxflow> m_graph;
+
+public:
+  /**
+   * @brief UndirectedGraphPlanar class constructor
+   *
+   * @param width number of nodes along x
+   * @param height number of nodes along y
+   */
+  UndirectedGraphPlanar(int width, int height)
+      : BaseGraph(nodeid(width * height)), m_graph(width, height) {}
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const PlanarStats &stats() const { return m_graph.stats(); }
+
+  /**
+   * @brief Adds an arc to the residual graph
+   *
+   * @param s source node
+   * @param t target node
+   * @param c capacity of arc
+   */
+  void add_arc(nodeid s, nodeid t, cap c) { m_graph.add_arc(s, t, c, c); }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    m_graph.set_tweights(s, scap, tcap);
+  }
+
+  /**
+   * @brief Compute the maxflow
+   *
+   * @return the maxflow
+   */
+  flow maxflow() { return m_graph.maxflow(); }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) { return m_graph.what_segment(s); }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -0,0 +1,529 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_ppr.h
+ *
+ * @brief Implementation of maxflow interface using a parallel push-relabel
+ * algorithm
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-07
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_PPR_H
+#define MAXFLOWLIB_MAXFLOW_PPR_H
+
+#include "maxflow.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "util/thread_pool.h"
+
+namespace maxflowlib {
+
+/**
+ * @brief What the last GraphPPR::maxflow call did
+ */
+struct PPRStats {
+  size_t rounds;
+  size_t discharges;
+  size_t global_relabels;
+  size_t gaps;
+
+  PPRStats() : rounds(0), discharges(0), global_relabels(0), gaps(0) {}
+};
+
+/**
+ * @brief Parallel push-relabel (Baumstark, Blelloch and Shun, Efficient
+ * Implementation of a Synchronous Parallel Push-Relabel Algorithm, ESA 2015).
+ *
+ * Every round discharges all active nodes in parallel against the labels of
+ * the previous round. Residual capacities and the excess pushed into a node
+ * are updated atomically, and a node with an admissible arc into another
+ * active node only pushes along it if it wins a tie break on the labels, so
+ * two nodes never push against each other. Nodes receiving excess are
+ * collected in per-thread lists for the next round, which are handed out to
+ * the threads in chunks as they finish theirs.
+ *
+ * Labels are reset by a parallel breadth first search from the sink after
+ * enough work, and nodes above an empty label are lifted out of reach (gap
+ * heuristic). Only the first phase is run: once no node with excess can
+ * reach the sink, the nodes that can form the sink side of a minimum cut.
+ */
+template <typename _nodeid = int, typename _arcid = int, typename _cap = int,
+          typename _flow = int>
+class GraphPPR : public Graph<_nodeid, _arcid, _cap, _flow> {
+
+public:
+  typedef Graph<_nodeid, _arcid, _cap, _flow> BaseGraph;
+  typedef typename BaseGraph::nodeid nodeid;
+  typedef typename BaseGraph::arcid arcid;
+  typedef typename BaseGraph::cap cap;
+  typedef typename BaseGraph::flow flow;
+
+private:
+  // global relabel once the relabel work since the last one exceeds
+  // ALPHA * nodes + arcs / 2, a relabel counting BETA plus its degree
+  static const size_t GLOBAL_RELABEL_ALPHA = 6;
+  static const size_t GLOBAL_RELABEL_BETA = 12;
+  static const size_t GRAIN = 32;
+
+  struct input_arc {
+    nodeid s, t;
+    cap fcap, rcap;
+  };
+
+  std::vector<input_arc> m_arcs;
+  std::vector<cap> m_source_cap;
+  std::vector<cap> m_sink_cap;
+
+  unsigned m_num_threads;
+  std::unique_ptr<util::ThreadPool> m_pool;
+
+  // residual graph in compressed rows, the sink is the last node
+  nodeid m_sink;
+  std::vector<arcid> m_first;
+  std::vector<nodeid> m_head;
+  std::vector<arcid> m_sister;
+  std::unique_ptr<std::atomic<cap>[]> m_rescap;
+
+  // labels range over [0, m_sink + 1], m_sink + 1 meaning cut off from the
+  // sink
+  nodeid m_max_label;
+  std::unique_ptr<std::atomic<nodeid>[]> m_label;
+  std::unique_ptr<std::atomic<nodeid>[]> m_label_count;
+  std::vector<flow> m_excess;
+  // excess pushed into a node during the current round
+  std::unique_ptr<std::atomic<flow>[]> m_added;
+  // round a node was last put on the next active list
+  std::unique_ptr<std::atomic<unsigned>[]> m_mark;
+  unsigned m_round;
+
+  std::vector<nodeid> m_active;
+  std::vector<std::vector<nodeid>> m_thread_active;
+  // label and excess of every active node after its discharge
+  std::vector<nodeid> m_discharge_label;
+  std::vector<flow> m_discharge_excess;
+  std::vector<size_t> m_thread_work;
+
+  flow m_constant_flow;
+  PPRStats m_stats;
+
+  void build_residual_graph() {
+    const nodeid n = BaseGraph::m_nnode;
+    m_sink = n;
+    m_constant_flow = 0;
+    std::vector<arcid> degree(n + 1, 0);
+    for (const input_arc &a : m_arcs) {
+      degree[a.s]++;
+      degree[a.t]++;
+    }
+    for (nodeid u = 0; u < n; ++u) {
+      // flow straight from the source to the sink through u
+      cap through = std::min(m_source_cap[u], m_sink_cap[u]);
+      m_constant_flow += through;
+      if (m_sink_cap[u] > through) {
+        degree[u]++;
+        degree[m_sink]++;
+      }
+    }
+    m_first.assign(n + 2, 0);
+    for (nodeid u = 0; u <= n; ++u) {
+      m_first[u + 1] = m_first[u] + degree[u];
+    }
+    const arcid narc = m_first[n + 1];
+    m_head.resize(narc);
+    m_sister.resize(narc);
+    m_rescap.reset(new std::atomic<cap>[narc]);
+    std::vector<arcid> next(m_first.begin(), m_first.end() - 1);
+    auto add_pair = [&](nodeid s, nodeid t, cap fcap, cap rcap) {
+      arcid a = next[s]++, b = next[t]++;
+      m_head[a] = t;
+      m_head[b] = s;
+      m_sister[a] = b;
+      m_sister[b] = a;
+      m_rescap[a].store(fcap, std::memory_order_relaxed);
+      m_rescap[b].store(rcap, std::memory_order_relaxed);
+    };
+    for (const input_arc &a : m_arcs) {
+      add_pair(a.s, a.t, a.fcap, a.rcap);
+    }
+    m_excess.assign(n + 1, 0);
+    for (nodeid u = 0; u < n; ++u) {
+      cap through = std::min(m_source_cap[u], m_sink_cap[u]);
+      if (m_sink_cap[u] > through) {
+        add_pair(u, m_sink, m_sink_cap[u] - through, 0);
+      }
+      m_excess[u] = m_source_cap[u] - through;
+    }
+
+    m_max_label = n + 1;
+    m_label.reset(new std::atomic<nodeid>[n + 1]);
+    m_label_count.reset(new std::atomic<nodeid>[m_max_label + 1]);
+    m_added.reset(new std::atomic<flow>[n + 1]);
+    m_mark.reset(new std::atomic<unsigned>[n + 1]);
+    for (nodeid u = 0; u <= n; ++u) {
+      m_added[u].store(0, std::memory_order_relaxed);
+      m_mark[u].store(0, std::memory_order_relaxed);
+    }
+    m_round = 0;
+  }
+
+  nodeid label(nodeid u) const {
+    return m_label[u].load(std::memory_order_relaxed);
+  }
+
+  cap rescap(arcid a) const {
+    return m_rescap[a].load(std::memory_order_relaxed);
+  }
+
+  bool is_active(nodeid u) const {
+    return u != m_sink && m_excess[u] > 0 && label(u) < m_max_label;
+  }
+
+  /**
+   * @brief Puts u on the calling thread's list for the next round, once
+   */
+  void activate(nodeid u, unsigned thread_id) {
+    if (m_mark[u].exchange(m_round, std::memory_order_relaxed) != m_round) {
+      m_thread_active[thread_id].push_back(u);
+    }
+  }
+
+  void gather_active() {
+    m_active.clear();
+    for (std::vector<nodeid> &list : m_thread_active) {
+      m_active.insert(m_active.end(), list.begin(), list.end());
+      list.clear();
+    }
+  }
+
+  /**
+   * @brief Parallel breadth first search from the sink in the residual graph,
+   * labels are set to the distance to the sink and the active nodes are
+   * collected again
+   */
+  void global_relabel() {
+    util::ThreadPool &pool = *m_pool;
+    const nodeid nnode = m_sink + 1;
+    pool.parallel_for(0, nnode, 1024, [&](size_t u, unsigned) {
+      m_label[u].store(m_max_label, std::memory_order_relaxed);
+    });
+    m_label[m_sink].store(0, std::memory_order_relaxed);
+    std::vector<nodeid> frontier(1, m_sink);
+    for (nodeid depth = 1; !frontier.empty(); ++depth) {
+      pool.parallel_for(
+          0, frontier.size(), GRAIN, [&](size_t i, unsigned thread_id) {
+            nodeid v = frontier[i];
+            for (arcid a = m_first[v]; a < m_first[v + 1]; ++a) {
+              nodeid w = m_head[a];
+              nodeid unreached = m_max_label;
+              if (rescap(m_sister[a]) > 0 &&
+                  label(w) == m_max_label &&
+                  m_label[w].compare_exchange_strong(
+                      unreached, depth, std::memory_order_relaxed)) {
+                m_thread_active[thread_id].push_back(w);
+              }
+            }
+          });
+      frontier.clear();
+      for (std::vector<nodeid> &list : m_thread_active) {
+        frontier.insert(frontier.end(), list.begin(), list.end());
+        list.clear();
+      }
+    }
+
+    for (nodeid l = 0; l <= m_max_label; ++l) {
+      m_label_count[l].store(0, std::memory_order_relaxed);
+    }
+    m_round++;
+    pool.parallel_for(0, m_sink, 1024, [&](size_t u, unsigned thread_id) {
+      m_label_count[label(nodeid(u))].fetch_add(1, std::memory_order_relaxed);
+      if (is_active(nodeid(u))) {
+        activate(nodeid(u), thread_id);
+      }
+    });
+    gather_active();
+    m_stats.global_relabels++;
+  }
+
+  /**
+   * @brief Pushes the excess of the i-th active node and relabels it against
+   * the labels of the previous round
+   *
+   * @return work done relabeling
+   */
+  size_t discharge(size_t i, unsigned thread_id) {
+    const nodeid v = m_active[i];
+    const nodeid old_label = label(v);
+    nodeid new_label = old_label;
+    flow excess = m_excess[v];
+    size_t work = 0;
+    // lifted out of reach by a gap since it was activated
+    while (excess > 0 && old_label < m_max_label) {
+      nodeid min_label = m_max_label;
+      bool skipped = false;
+      for (arcid a = m_first[v]; a < m_first[v + 1] && excess > 0; ++a) {
+        cap r = rescap(a);
+        if (r == 0) {
+          continue;
+        }
+        const nodeid w = m_head[a];
+        const nodeid w_label = label(w);
+        const bool admissible = new_label == w_label + 1;
+        // of two active nodes with an admissible arc between them, only
+        // one pushes along it
+        if (admissible && is_active(w)) {
+          const bool wins = old_label == w_label + 1 ||
+                            old_label + 1 < w_label ||
+                            (old_label == w_label && v < w);
+          if (!wins) {
+            skipped = true;
+            continue;
+          }
+        }
+        if (admissible) {
+          cap delta = cap(std::min<flow>(r, excess));
+          m_rescap[a].fetch_sub(delta, std::memory_order_relaxed);
+          m_rescap[m_sister[a]].fetch_add(delta, std::memory_order_relaxed);
+          m_added[w].fetch_add(delta, std::memory_order_relaxed);
+          if (w != m_sink) {
+            activate(w, thread_id);
+          }
+          excess -= delta;
+          r -= delta;
+        }
+        if (r > 0 && w_label < min_label) {
+          min_label = w_label;
+        }
+      }
+      if (excess == 0 || skipped) {
+        break;
+      }
+      work += GLOBAL_RELABEL_BETA + (m_first[v + 1] - m_first[v]);
+      new_label = std::min<nodeid>(min_label + 1, m_max_label);
+      if (new_label == m_max_label) {
+        break;
+      }
+    }
+    m_discharge_label[i] = new_label;
+    m_discharge_excess[i] = excess;
+    if (excess > 0 && new_label < m_max_label) {
+      activate(v, thread_id);
+    }
+    return work;
+  }
+
+  /**
+   * @brief Lifts every node above label gap out of reach of the sink
+   */
+  void lift_above_gap(nodeid gap) {
+    m_pool->parallel_for(0, m_sink, 1024, [&](size_t u, unsigned) {
+      nodeid l = label(nodeid(u));
+      if (l > gap && l < m_max_label) {
+        m_label[u].store(m_max_label, std::memory_order_relaxed);
+      }
+    });
+    nodeid lifted = 0;
+    for (nodeid l = gap + 1; l < m_max_label; ++l) {
+      lifted += m_label_count[l].exchange(0, std::memory_order_relaxed);
+    }
+    m_label_count[m_max_label].fetch_add(lifted, std::memory_order_relaxed);
+    m_stats.gaps++;
+  }
+
+  /**
+   * @brief Discharges the active nodes in parallel and applies the new
+   * labels and excesses
+   *
+   * @return work done relabeling
+   */
+  size_t run_round() {
+    util::ThreadPool &pool = *m_pool;
+    const size_t nactive = m_active.size();
+    m_discharge_label.resize(nactive);
+    m_discharge_excess.resize(nactive);
+    std::fill(m_thread_work.begin(), m_thread_work.end(), 0);
+    m_round++;
+    pool.parallel_for(0, nactive, GRAIN, [&](size_t i, unsigned thread_id) {
+      m_thread_work[thread_id] += discharge(i, thread_id);
+    });
+
+    // lowest label left empty by a relabel
+    std::atomic<nodeid> gap(m_max_label);
+    pool.parallel_for(0, nactive, 1024, [&](size_t i, unsigned) {
+      nodeid v = m_active[i], old_label = label(v);
+      nodeid new_label = m_discharge_label[i];
+      m_excess[v] = m_discharge_excess[i];
+      if (new_label == old_label) {
+        return;
+      }
+      m_label[v].store(new_label, std::memory_order_relaxed);
+      m_label_count[new_label].fetch_add(1, std::memory_order_relaxed);
+      if (m_label_count[old_label].fetch_sub(1, std::memory_order_relaxed) ==
+          1) {
+        nodeid g = gap.load(std::memory_order_relaxed);
+        while (old_label < g &&
+               !gap.compare_exchange_weak(g, old_label,
+                                          std::memory_order_relaxed)) {
+        }
+      }
+    });
+    gather_active();
+    pool.parallel_for(0, m_active.size(), 1024, [&](size_t i, unsigned) {
+      nodeid w = m_active[i];
+      m_excess[w] += m_added[w].exchange(0, std::memory_order_relaxed);
+    });
+    const nodeid g = gap.load(std::memory_order_relaxed);
+    if (g < m_max_label && m_label_count[g].load(std::memory_order_relaxed) ==
+                               0) {
+      lift_above_gap(g);
+    }
+    m_stats.rounds++;
+    m_stats.discharges += nactive;
+
+    size_t work = 0;
+    for (size_t w : m_thread_work) {
+      work += w;
+    }
+    return work;
+  }
+
+public:
+  /**
+   * @brief GraphPPR class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   * @param num_threads threads discharging nodes, 0 uses the hardware
+   * concurrency
+   */
+  GraphPPR(nodeid nnode, arcid narc, unsigned num_threads = 0)
+      : BaseGraph(nnode, narc), m_source_cap(nnode, 0), m_sink_cap(nnode, 0),
+        m_num_threads(num_threads), m_sink(nnode), m_max_label(nnode + 1),
+        m_round(0), m_constant_flow(0) {
+    m_arcs.reserve(narc);
+  }
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const PPRStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Adds an arc to the residual graph (also adds the residual (reverse)
+   * arc)
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    if (s != t && (fcap > 0 || rcap > 0)) {
+      input_arc a = {s, t, fcap, rcap};
+      m_arcs.push_back(a);
+    }
+  }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    m_source_cap[s] += scap;
+    m_sink_cap[s] += tcap;
+  }
+
+  /**
+   * @brief Compute the maxflow
+   *
+   * @return the maxflow
+   */
+  flow maxflow() {
+    m_stats = PPRStats();
+    unsigned num_threads = m_num_threads;
+    if (num_threads == 0) {
+      num_threads = std::thread::hardware_concurrency();
+    }
+    num_threads = std::max(1u, num_threads);
+    if (!m_pool || m_pool->size() != num_threads) {
+      m_pool.reset(new util::ThreadPool(num_threads));
+    }
+    m_thread_active.assign(num_threads, std::vector<nodeid>());
+    m_thread_work.assign(num_threads, 0);
+
+    build_residual_graph();
+    const size_t relabel_threshold =
+        GLOBAL_RELABEL_ALPHA * size_t(m_sink + 1) + m_head.size() / 2;
+    global_relabel();
+    size_t work = 0;
+    while (!m_active.empty()) {
+      work += run_round();
+      // the last global relabel also finds the cut, and nodes with excess
+      // that were lifted too far
+      if (m_active.empty() || work > relabel_threshold) {
+        global_relabel();
+        work = 0;
+      }
+    }
+    return m_constant_flow + m_added[m_sink].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) { return label(s) < m_max_label; }
+
+  size_t memory_bytes() const {
+    using detail::vector_bytes;
+    size_t bytes = vector_bytes(m_arcs) + vector_bytes(m_source_cap) +
+                   vector_bytes(m_sink_cap) + vector_bytes(m_first) +
+                   vector_bytes(m_head) + vector_bytes(m_sister) +
+                   vector_bytes(m_excess) + vector_bytes(m_active) +
+                   vector_bytes(m_discharge_label) +
+                   vector_bytes(m_discharge_excess) +
+                   vector_bytes(m_thread_work);
+    for (const std::vector<nodeid> &list : m_thread_active) {
+      bytes += vector_bytes(list);
+    }
+    if (m_rescap) {
+      const size_t n = size_t(m_sink) + 1;
+      bytes += m_head.size() * sizeof(std::atomic<cap>) +
+               n * (sizeof(std::atomic<nodeid>) + sizeof(std::atomic<flow>) +
+                    sizeof(std::atomic<unsigned>)) +
+               (size_t(m_max_label) + 1) * sizeof(std::atomic<nodeid>);
+    }
+    return bytes;
+  }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -0,0 +1,601 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file maxflow_presolve.h
+ *
+ * @brief Implementation of maxflow interface that reduces the graph with
+ * exact rules before handing it to any of the directed maxflow
+ * implementations.
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-04
+ *
+ */
+#ifndef MAXFLOWLIB_MAXFLOW_PRESOLVE_H
+#define MAXFLOWLIB_MAXFLOW_PRESOLVE_H
+
+#include "maxflow.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <cassert>
+#include "util/adjacency_lists.h"
+#include "util/block_arena.h"
+#include "util/timer.h"
+
+namespace maxflowlib {
+
+/**
+ * @brief What the last GraphPresolve::maxflow call did, node and arc counts
+ * exclude the terminals, arcs count node pairs.
+ */
+struct PresolveStats {
+  size_t nodes_before, nodes_after;
+  size_t arcs_before, arcs_after;
+  size_t unreachable;
+  size_t contracted;
+  double presolve_seconds;
+  double build_seconds;
+  double solve_seconds;
+
+  PresolveStats()
+      : nodes_before(0), nodes_after(0), arcs_before(0), arcs_after(0),
+        unreachable(0), contracted(0), presolve_seconds(0), build_seconds(0),
+        solve_seconds(0) {}
+};
+
+/**
+ * @brief Wraps a directed maxflow implementation, reducing the graph with
+ * exact rules before building it:
+ *
+ * - arcs between the same pair of nodes are merged,
+ * - opposing source and sink capacities of a node are cancelled,
+ * - nodes the source cannot reach are put on the sink side and nodes that
+ *   cannot reach the sink on the source side,
+ * - a node whose source (sink) capacity is at least all the capacity it can
+ *   lose to the sink (source) side is put on the source (sink) side,
+ * - an arc pair is contracted when a cut separating its nodes either way can
+ *   be repaired by moving one of them without increasing the cut.
+ *
+ * The cut found on the reduced graph is mapped back to the original nodes
+ * and maxflow returns the value of that cut.
+ */
+template <typename GraphMaxflow>
+class GraphPresolve
+    : public Graph<typename GraphMaxflow::nodeid, typename GraphMaxflow::arcid,
+                   typename GraphMaxflow::cap, typename GraphMaxflow::flow> {
+public:
+  typedef typename GraphMaxflow::nodeid nodeid;
+  typedef typename GraphMaxflow::arcid arcid;
+  typedef typename GraphMaxflow::cap cap;
+  typedef typename GraphMaxflow::flow flow;
+  typedef Graph<nodeid, arcid, cap, flow> BaseGraph;
+
+private:
+  /**
+   * @brief An arc as passed to add_arc, kept until the reduction graph is
+   * built.
+   */
+  struct input_arc {
+    nodeid s, t;
+    cap fcap, rcap;
+  };
+
+  /**
+   * @brief An entry of a neighbor list, neighbor lists are kept sorted by
+   * head. out is the capacity of the arc to head, in of the arc from head.
+   */
+  struct adjacency_arc {
+    nodeid head;
+    flow out, in;
+
+    void add(const adjacency_arc &a) {
+      out += a.out;
+      in += a.in;
+    }
+  };
+
+  const nodeid SOURCEID, SINKID;
+  const nodeid NO_NODE;
+
+  std::vector<input_arc> m_input_arcs;
+  std::vector<flow> m_source_cap;
+  std::vector<flow> m_sink_cap;
+
+  // terminals are never stored in neighbor lists but in
+  // m_source_cap/m_sink_cap
+  util::AdjacencyLists<adjacency_arc, nodeid> m_adjacency;
+  // storage for neighbor lists that outgrow their slot
+  util::BlockArena<adjacency_arc> m_arena;
+  std::vector<adjacency_arc> m_merge_buffer;
+  // capacity of the arcs into and out of a node, terminal arcs excluded
+  std::vector<flow> m_in_cap;
+  std::vector<flow> m_out_cap;
+  // union-find forest over the nodes, roots are the supernodes
+  std::vector<nodeid> m_super_node;
+  std::vector<nodeid> m_super_node_size;
+  std::vector<nodeid> m_worklist;
+  std::vector<char> m_in_worklist;
+  // flow of the input graph not represented in the reduced graph
+  flow m_constant_flow;
+
+  PresolveStats m_stats;
+  std::vector<nodeid> m_new_super_node_id;
+  std::vector<bool> m_what_segment;
+
+  nodeid num_inner_nodes() const { return BaseGraph::m_nnode; }
+
+  bool is_terminal(nodeid u) const { return u == SOURCEID || u == SINKID; }
+
+  /**
+   * @brief Builds the sorted neighbor lists (CSR) from the arcs added so far,
+   * merging the arcs between the same pair of nodes.
+   */
+  void build_adjacency() {
+    const nodeid n = num_inner_nodes();
+    m_arena.clear();
+    auto to_arcs = [](const input_arc &a, adjacency_arc &sa,
+                      adjacency_arc &ta) {
+      adjacency_arc out = {a.t, a.fcap, a.rcap}, in = {a.s, a.rcap, a.fcap};
+      sa = out;
+      ta = in;
+    };
+    m_stats.arcs_before = m_adjacency.build(n, m_input_arcs, to_arcs) / 2;
+    std::vector<input_arc>().swap(m_input_arcs);
+    m_in_cap.assign(n, 0);
+    m_out_cap.assign(n, 0);
+    for (nodeid u = 0; u < n; ++u) {
+      const adjacency_arc *arcs = m_adjacency.arcs(u);
+      for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+        m_out_cap[u] += arcs[k].out;
+        m_in_cap[u] += arcs[k].in;
+      }
+    }
+  }
+
+  void init_presolve() {
+    build_adjacency();
+    m_constant_flow = 0;
+    m_super_node.resize(BaseGraph::m_nnode + 2);
+    for (nodeid i = 0; i < BaseGraph::m_nnode + 2; ++i) {
+      m_super_node[i] = i;
+    }
+    m_super_node_size.assign(BaseGraph::m_nnode + 2, 1);
+    m_in_worklist.assign(BaseGraph::m_nnode, 0);
+    m_worklist.clear();
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      cancel_terminal_caps(u);
+    }
+  }
+
+  /**
+   * @brief Removes the common part of the source and sink capacities of u,
+   * which is cut whatever side u is on.
+   */
+  void cancel_terminal_caps(nodeid u) {
+    flow common = std::min(m_source_cap[u], m_sink_cap[u]);
+    m_source_cap[u] -= common;
+    m_sink_cap[u] -= common;
+    m_constant_flow += common;
+  }
+
+  void enqueue_node(nodeid u) {
+    if (!is_terminal(u) && !m_in_worklist[u]) {
+      m_in_worklist[u] = 1;
+      m_worklist.push_back(u);
+    }
+  }
+
+  /**
+   * @brief Puts u on the side of terminal v. Arcs between u and the other
+   * side become terminal arcs of the neighbors, the others can never be cut
+   * and are dropped.
+   */
+  void contract_into_terminal(nodeid u, nodeid v) {
+    m_super_node[u] = v;
+    const bool source = v == SOURCEID;
+    m_constant_flow += source ? m_sink_cap[u] : m_source_cap[u];
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      const adjacency_arc &a = m_adjacency.arcs(u)[k];
+      nodeid w = a.head;
+      m_adjacency.erase(w, m_adjacency.find(w, u));
+      if (source) {
+        m_source_cap[w] += a.out;
+        m_in_cap[w] -= a.out;
+        m_out_cap[w] -= a.in;
+      } else {
+        m_sink_cap[w] += a.in;
+        m_out_cap[w] -= a.in;
+        m_in_cap[w] -= a.out;
+      }
+      cancel_terminal_caps(w);
+      enqueue_node(w);
+    }
+    clear_node(u);
+  }
+
+  /**
+   * @brief Contracts the arcs between u and v into a single node
+   */
+  void contract_arc(nodeid u, nodeid v) {
+    if (m_super_node_size[u] > m_super_node_size[v]) {
+      std::swap(u, v);
+    }
+    // contract u into v
+    m_super_node[u] = v;
+    m_super_node_size[v] += m_super_node_size[u];
+    flow uv_out = 0, uv_in = 0;
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      const adjacency_arc &a = m_adjacency.arcs(u)[k];
+      if (a.head == v) {
+        uv_out = a.out;
+        uv_in = a.in;
+        continue;
+      }
+      // the arc from a.head to u, now to v
+      adjacency_arc moved = {v, a.in, a.out};
+      m_adjacency.rewire(a.head, u, moved);
+    }
+    m_adjacency.merge(u, v, m_merge_buffer, m_arena);
+    m_in_cap[v] += m_in_cap[u] - uv_out - uv_in;
+    m_out_cap[v] += m_out_cap[u] - uv_out - uv_in;
+    m_source_cap[v] += m_source_cap[u];
+    m_sink_cap[v] += m_sink_cap[u];
+    cancel_terminal_caps(v);
+    enqueue_node(v);
+    for (nodeid k = 0; k < m_adjacency.degree(v); ++k) {
+      enqueue_node(m_adjacency.arcs(v)[k].head);
+    }
+    clear_node(u);
+  }
+
+  void clear_node(nodeid u) {
+    m_adjacency.clear(u);
+    m_source_cap[u] = 0;
+    m_sink_cap[u] = 0;
+    m_in_cap[u] = 0;
+    m_out_cap[u] = 0;
+  }
+
+  /**
+   * @brief Nodes reachable from a terminal through arcs of positive capacity,
+   * forward from the source or backward from the sink.
+   */
+  std::vector<char> reachable_from_terminal(bool from_source) const {
+    std::vector<char> reached(num_inner_nodes(), 0);
+    std::vector<nodeid> stack;
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      if ((from_source ? m_source_cap[u] : m_sink_cap[u]) > 0) {
+        reached[u] = 1;
+        stack.push_back(u);
+      }
+    }
+    while (!stack.empty()) {
+      nodeid u = stack.back();
+      stack.pop_back();
+      for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+        const adjacency_arc &a = m_adjacency.arcs(u)[k];
+        if (!reached[a.head] && (from_source ? a.out : a.in) > 0) {
+          reached[a.head] = 1;
+          stack.push_back(a.head);
+        }
+      }
+    }
+    return reached;
+  }
+
+  /**
+   * @brief Puts the nodes the source cannot reach on the sink side, then the
+   * nodes that cannot reach the sink on the source side. The minimal source
+   * set of a minimum cut only holds nodes the source reaches, so the first
+   * step is exact, and likewise the second.
+   *
+   * @return number of nodes removed
+   */
+  nodeid remove_unreachable() {
+    nodeid num_removed = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+      const bool from_source = pass == 0;
+      std::vector<char> reached = reachable_from_terminal(from_source);
+      for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+        if (!reached[u] && m_super_node[u] == u) {
+          contract_into_terminal(u, from_source ? SINKID : SOURCEID);
+          num_removed++;
+        }
+      }
+    }
+    return num_removed;
+  }
+
+  /**
+   * @brief Finds an exact reduction of u.
+   *
+   * With u on the sink side, moving it to the source side changes the cut by
+   * at most sink_cap + out_cap - source_cap, so u can go to the source side
+   * when that is not positive, and likewise for the sink side. A cut with u
+   * on the source side and v on the sink side cuts c(u,v), and moving u
+   * changes it by at most in(u) - c(u,v), moving v by at most out(v) -
+   * c(u,v), where in and out include the terminal arcs. If this and the
+   * opposite case can both be repaired, u and v can be contracted.
+   *
+   * @return the node to contract u with or NO_NODE
+   */
+  nodeid find_reduction(nodeid u) const {
+    const flow su = m_source_cap[u], tu = m_sink_cap[u];
+    const flow in_u = su + m_in_cap[u], out_u = tu + m_out_cap[u];
+    if (su >= out_u) {
+      return SOURCEID;
+    }
+    if (tu >= in_u) {
+      return SINKID;
+    }
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      const adjacency_arc &a = m_adjacency.arcs(u)[k];
+      const nodeid v = a.head;
+      const flow in_v = m_source_cap[v] + m_in_cap[v];
+      const flow out_v = m_sink_cap[v] + m_out_cap[v];
+      if (a.out >= std::min(in_u, out_v) && a.in >= std::min(in_v, out_u)) {
+        return v;
+      }
+    }
+    return NO_NODE;
+  }
+
+  /**
+   * @brief Applies the reductions until none applies, after the first pass
+   * only nodes whose neighborhood changed are tested again.
+   *
+   * @return number of contracted nodes
+   */
+  nodeid reduce_to_fixed_point() {
+    nodeid num_contracted = 0;
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      if (m_super_node[u] == u) {
+        enqueue_node(u);
+      }
+    }
+    while (!m_worklist.empty()) {
+      nodeid u = m_worklist.back();
+      m_worklist.pop_back();
+      m_in_worklist[u] = 0;
+      if (m_super_node[u] != u) {
+        continue;
+      }
+      nodeid v = find_reduction(u);
+      if (v == NO_NODE) {
+        continue;
+      }
+      if (is_terminal(v)) {
+        contract_into_terminal(u, v);
+      } else {
+        contract_arc(u, v);
+      }
+      num_contracted++;
+    }
+    return num_contracted;
+  }
+
+  void presolve() {
+    init_presolve();
+    m_stats.unreachable = remove_unreachable();
+    m_stats.contracted = reduce_to_fixed_point();
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      util::find_root(m_super_node, u);
+    }
+  }
+
+  nodeid set_new_super_node_id() {
+    m_new_super_node_id.assign(num_inner_nodes(), -1);
+    nodeid super_node_count = 0;
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      if (m_super_node[u] == u) { // is a supernode
+        m_new_super_node_id[u] = super_node_count++;
+      }
+    }
+    return super_node_count;
+  }
+
+  /**
+   * @brief Arcs add_arcs adds, a pair of nodes with capacity both ways takes
+   * two
+   */
+  arcid count_arcs() const {
+    arcid num_arc = 0;
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+        const adjacency_arc &a = m_adjacency.arcs(u)[k];
+        if (u < a.head) {
+          num_arc += a.out > 0 && a.in > 0 ? 2 : 1;
+        }
+      }
+    }
+    return num_arc;
+  }
+
+  /**
+   * @brief Adds the reduced graph to g. Merged arcs with capacity both ways
+   * are added as two arcs, engines such as HPF take only one capacity per
+   * arc.
+   */
+  void add_arcs(GraphMaxflow &g) const {
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+        const adjacency_arc &a = m_adjacency.arcs(u)[k];
+        if (u >= a.head) {
+          continue;
+        }
+        const nodeid s = m_new_super_node_id[u];
+        const nodeid t = m_new_super_node_id[a.head];
+        if (a.out > 0 && a.in > 0) {
+          g.add_arc(s, t, a.out, 0);
+          g.add_arc(t, s, a.in, 0);
+        } else {
+          g.add_arc(s, t, a.out, a.in);
+        }
+      }
+    }
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      if (m_source_cap[u] > 0 || m_sink_cap[u] > 0) {
+        g.set_tweights(m_new_super_node_id[u], m_source_cap[u],
+                       m_sink_cap[u]);
+      }
+    }
+  }
+
+  /**
+   * @brief Sets the segment of the nodes contracted into a terminal, all of
+   * them when every node was removed
+   */
+  void get_terminal_segments() {
+    m_what_segment.assign(num_inner_nodes(), false);
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      if (m_super_node[u] == SINKID) {
+        m_what_segment[u] = true;
+      }
+    }
+  }
+
+  /**
+   * @brief Sets the segment of every node, g is the solved reduced graph
+   */
+  void get_what_segments(GraphMaxflow &g) {
+    get_terminal_segments();
+    for (nodeid u = 0; u < num_inner_nodes(); ++u) {
+      nodeid sn = m_super_node[u];
+      if (!is_terminal(sn)) {
+        m_what_segment[u] = g.what_segment(m_new_super_node_id[sn]);
+      }
+    }
+  }
+
+public:
+  /**
+   * @brief GraphPresolve class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param narc  number of arcs in the graph
+   */
+  GraphPresolve(nodeid nnode, arcid narc)
+      : BaseGraph(nnode, narc), SOURCEID(nnode), SINKID(nnode + 1),
+        NO_NODE(nodeid(-1)), m_source_cap(nnode, 0), m_sink_cap(nnode, 0),
+        m_constant_flow(0) {
+    m_input_arcs.reserve(narc);
+  }
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const PresolveStats &stats() const { return m_stats; }
+
+  /**
+   * @brief Adds an arc to the residual graph (also adds the residual (reverse)
+   * arc)
+   *
+   * @param s source node
+   * @param t target node
+   * @param fcap capacity of forward arc
+   * @param rcap capacity of reverse arc
+   */
+  void add_arc(nodeid s, nodeid t, cap fcap, cap rcap) {
+    if (s != t && (fcap > 0 || rcap > 0)) {
+      input_arc a = {s, t, fcap, rcap};
+      m_input_arcs.push_back(a);
+    }
+  }
+
+  /**
+   * @brief Adds source and sink connection to node, capacities of repeated
+   * calls are summed
+   *
+   * @param s node
+   * @param scap capacity of arc source -> node
+   * @param tcap capacity of arc node -> sink
+   */
+  void set_tweights(nodeid s, cap scap, cap tcap) {
+    m_source_cap[s] += scap;
+    m_sink_cap[s] += tcap;
+  }
+
+  /**
+   * @brief Compute the maxflow, the graph can be solved only once
+   *
+   * @return the maxflow
+   */
+  flow maxflow() {
+    m_stats = PresolveStats();
+    m_stats.nodes_before = size_t(num_inner_nodes());
+
+    util::Timer timer_presolve;
+    timer_presolve.tic();
+    presolve();
+    nodeid num_node = set_new_super_node_id();
+    arcid num_arc = count_arcs();
+    timer_presolve.toc();
+    m_stats.presolve_seconds = timer_presolve.elapsed_seconds();
+    m_stats.nodes_after = size_t(num_node);
+    m_stats.arcs_after = size_t(num_arc);
+
+    if (!num_node) { // every node was removed
+      get_terminal_segments();
+      return m_constant_flow;
+    }
+
+    util::Timer timer_build, timer_solve;
+    timer_build.tic();
+    GraphMaxflow graph(num_node, num_arc);
+    add_arcs(graph);
+    timer_build.toc();
+    timer_solve.tic();
+    flow f = graph.maxflow();
+    timer_solve.toc();
+    m_stats.build_seconds = timer_build.elapsed_seconds();
+    m_stats.solve_seconds = timer_solve.elapsed_seconds();
+
+    get_what_segments(graph);
+
+    return f + m_constant_flow;
+  }
+
+  /**
+   * @brief Return which segment a node belongs to in the minimum cut
+   *
+   * @param s the node
+   *
+   * @return either 0 - indicates source segment or 1 - indicates sink segment
+   */
+  bool what_segment(nodeid s) { return m_what_segment[s]; }
+
+  /**
+   * @brief Bytes held by the presolve, the reduced graph is only alive
+   * during maxflow and not counted
+   */
+  size_t memory_bytes() const {
+    using detail::vector_bytes;
+    return vector_bytes(m_input_arcs) + vector_bytes(m_source_cap) +
+           vector_bytes(m_sink_cap) + m_adjacency.memory_bytes() +
+           vector_bytes(m_merge_buffer) +
+           vector_bytes(m_in_cap) + vector_bytes(m_out_cap) +
+           vector_bytes(m_super_node) + vector_bytes(m_super_node_size) +
+           vector_bytes(m_worklist) + vector_bytes(m_in_worklist) +
+           vector_bytes(m_new_super_node_id) + vector_bytes(m_what_segment);
+  }
+};
+
+} // namespace maxflowlib
+
+#endif
@@ -30,16 +30,61 @@
 #include "maxflow_undirected.h"
 #include <stdexcept>
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include <cassert>
+#include "util/adjacency_lists.h"
+#include "util/block_arena.h"
+#include "util/thread_pool.h"
 #include "util/timer.h"
 
-#define USE_PROBABILISTIC_CONTRACTION 1
-
 namespace maxflowlib {
 
+/**
+ * @brief Options controlling how UndirectedGraphSlimCuts contracts the graph
+ * before handing it to the directed maxflow engine.
+ */
+struct SlimCutsOptions {
+  // contraction cutoffs, each applied to a fixed point in order. A cutoff of
+  // 1 is exact, larger cutoffs contract more but the cut may not be minimal.
+  // The exact reduction rules are applied in every pass
+  std::vector<double> cutoffs;
+  // only apply the exact rule (cutoff 1), cutoffs is ignored
+  bool exact_only;
+  // maximum number of worklist rounds per cutoff, 0 for no limit
+  int max_rounds;
+  // threads used to contract, 0 uses the hardware concurrency
+  unsigned num_threads;
+
+  SlimCutsOptions()
+      : cutoffs({1., 1.1, 1.2, 1.3, 1.4, 1.5}), exact_only(false),
+        max_rounds(0), num_threads(1) {}
+};
+
+/**
+ * @brief What the last UndirectedGraphSlimCuts::maxflow call did, node and
+ * arc counts exclude the terminals.
+ */
+struct SlimCutsStats {
+  size_t nodes_before, nodes_after;
+  size_t arcs_before, arcs_after;
+  size_t contracted;
+  size_t eliminated;
+  size_t rounds;
+  double contraction_seconds;
+  double build_seconds;
+  double solve_seconds;
+
+  SlimCutsStats()
+      : nodes_before(0), nodes_after(0), arcs_before(0), arcs_after(0),
+        contracted(0), eliminated(0), rounds(0), contraction_seconds(0),
+        build_seconds(0), solve_seconds(0) {}
+};
+
 template <typename GraphMaxflow>
 class UndirectedGraphSlimCuts
     : public UndirectedGraph<
@@ -53,172 +98,600 @@ public:
   typedef UndirectedGraph<nodeid, arcid, cap, flow> BaseGraph;
 
 private:
-  typedef std::unordered_map<nodeid, flow> adjacency_map;
-  typedef std::vector<adjacency_map> adjacency_list;
+  /**
+   * @brief An arc as passed to add_arc, kept until the contraction graph is
+   * built.
+   */
+  struct input_arc {
+    nodeid s, t;
+    cap c;
+  };
+
+  /**
+   * @brief An entry of a neighbor list, neighbor lists are kept sorted by
+   * head.
+   */
+  struct adjacency_arc {
+    nodeid head;
+    flow f;
+
+    void add(const adjacency_arc &a) { f += a.f; }
+  };
+
+  /**
+   * @brief A degree-2 node replaced by a triangle between its neighbors v, w
+   * and its terminal, kept to place it once the sides of v and w are known.
+   */
+  struct eliminated_node {
+    nodeid u, v, w, terminal;
+    flow a, b, c; // capacities of (u,v), (u,w) and (u,terminal)
+  };
+
+  /**
+   * @brief Scratch state of one contracting thread.
+   */
+  struct contraction_context {
+    // storage for neighbor lists that outgrow their slot
+    util::BlockArena<adjacency_arc> arena;
+    std::vector<adjacency_arc> merge_buffer;
+    // nodes whose neighborhood changed, to be put on the worklist
+    std::vector<nodeid> touched;
+    std::vector<eliminated_node> eliminated;
+    // flow through source-sink paths removed from the graph
+    flow constant_flow;
+
+    contraction_context() : constant_flow(0) {}
+  };
+
+  // below this many nodes on the worklist a round is run sequentially
+  static const size_t PARALLEL_MIN_WORKLIST = 4096;
+  // triangle tests are skipped on arcs with an end of higher degree
+  static const nodeid TRIANGLE_MAX_DEGREE = 64;
 
   const nodeid SOURCEID, SINKID;
+  const nodeid NO_NODE;
+
+  std::vector<input_arc> m_input_arcs;
+  std::vector<flow> m_source_cap;
+  std::vector<flow> m_sink_cap;
+
+  // terminals are never stored in neighbor lists but in
+  // m_source_cap/m_sink_cap
+  util::AdjacencyLists<adjacency_arc, nodeid> m_adjacency;
+  std::vector<contraction_context> m_contexts;
 
-  adjacency_list m_adj;
   std::vector<flow> m_total_cap_at_node;
+  // union-find forest over the nodes, roots are the supernodes
   std::vector<nodeid> m_super_node;
+  std::vector<nodeid> m_super_node_size;
+  std::vector<char> m_is_eliminated;
+  std::vector<eliminated_node> m_eliminated_nodes;
+  // flow of the input graph not represented in the contracted graph
+  flow m_constant_flow;
+  // upper bound on the minimum cut of the contracted graph, infinite outside
+  // of exact passes as contracting under a larger cutoff may raise the cut
+  double m_cut_bound;
+  // nodes whose neighborhood changed since they were last tested
+  std::vector<nodeid> m_worklist;
+  std::vector<nodeid> m_next_worklist;
+  std::vector<char> m_in_worklist;
+
+  // parallel contraction: candidate target per worklist entry and per node
+  // the claim (round << 32 | lowest claiming node) of the current round
+  std::vector<nodeid> m_candidate;
+  std::vector<char> m_selected;
+  std::unique_ptr<std::atomic<unsigned long long>[]> m_claims;
+  unsigned long long m_round;
+  std::unique_ptr<util::ThreadPool> m_pool;
+
+  SlimCutsOptions m_options;
+  SlimCutsStats m_stats;
   std::vector<nodeid> m_new_super_node_id;
   std::vector<bool> m_what_segment;
 
-  void add_to_adj_map(nodeid s, nodeid t, cap c) {
-    adjacency_map &map = m_adj[s];
-    typename adjacency_map::iterator it = map.find(t);
-    if (it != map.end()) { // found, increase
-      it->second = c;
-    } else { // not found, create
-      map.insert(std::make_pair(t, c));
+  nodeid num_inner_nodes() const { return BaseGraph::m_nnode - 2; }
+
+  bool is_terminal(nodeid u) const { return u == SOURCEID || u == SINKID; }
+
+  bool is_super_node(nodeid u) const {
+    return m_super_node[u] == u && !m_is_eliminated[u];
+  }
+
+  /**
+   * @brief Builds the sorted neighbor lists (CSR) from the arcs added so far,
+   * the capacities of repeated arcs are summed.
+   */
+  void build_adjacency() {
+    auto to_arcs = [](const input_arc &a, adjacency_arc &sa,
+                      adjacency_arc &ta) {
+      adjacency_arc out = {a.t, a.c}, in = {a.s, a.c};
+      sa = out;
+      ta = in;
+    };
+    m_stats.arcs_before =
+        m_adjacency.build(num_inner_nodes(), m_input_arcs, to_arcs) / 2;
+    unsigned num_threads = m_options.num_threads;
+    if (num_threads == 0) {
+      num_threads = std::thread::hardware_concurrency();
+    }
+    if (num_threads > 1) {
+      if (!m_pool || m_pool->size() != num_threads) {
+        m_pool.reset(new util::ThreadPool(num_threads));
+      }
+    } else {
+      m_pool.reset();
+    }
+    m_contexts.resize(m_pool ? m_pool->size() : 1);
+    for (contraction_context &ctx : m_contexts) {
+      ctx.arena.clear();
+      ctx.touched.clear();
+      ctx.eliminated.clear();
+      ctx.constant_flow = 0;
     }
   }
 
+  /**
+   * @brief Removes the common part of the source and sink capacities of u,
+   * which is cut whatever side u is on.
+   */
+  void cancel_terminal_caps(nodeid u, flow &constant_flow) {
+    flow common = std::min(m_source_cap[u], m_sink_cap[u]);
+    m_source_cap[u] -= common;
+    m_sink_cap[u] -= common;
+    m_total_cap_at_node[u] -= 2 * common;
+    constant_flow += common;
+  }
+
   void init_graph_contraction() {
-    m_total_cap_at_node.resize(BaseGraph::m_nnode);
-    for (nodeid i = 0; i < BaseGraph::m_nnode; ++i) {
-      adjacency_map &lmap = m_adj[i];
-      flow total = 0;
-      for (auto &it : lmap) {
-        total += it.second;
+    build_adjacency();
+    m_constant_flow = 0;
+    m_total_cap_at_node.assign(BaseGraph::m_nnode, 0);
+    for (nodeid i = 0; i < num_inner_nodes(); ++i) {
+      flow total = m_source_cap[i] + m_sink_cap[i];
+      for (nodeid k = 0; k < m_adjacency.degree(i); ++k) {
+        total += m_adjacency.arcs(i)[k].f;
       }
       m_total_cap_at_node[i] = total;
+      cancel_terminal_caps(i, m_constant_flow);
     }
     m_super_node.assign(BaseGraph::m_nnode, 0);
     for (nodeid i = 0; i < BaseGraph::m_nnode; ++i) {
       m_super_node[i] = i;
     }
+    m_super_node_size.assign(BaseGraph::m_nnode, 1);
+    m_is_eliminated.assign(BaseGraph::m_nnode, 0);
+    m_eliminated_nodes.clear();
+    m_in_worklist.assign(BaseGraph::m_nnode, 0);
+    m_worklist.clear();
+    m_next_worklist.clear();
+    if (m_pool) {
+      m_claims.reset(new std::atomic<unsigned long long>[BaseGraph::m_nnode]);
+      for (nodeid i = 0; i < BaseGraph::m_nnode; ++i) {
+        m_claims[i].store(0, std::memory_order_relaxed);
+      }
+      m_round = 0;
+    }
+  }
+
+  void enqueue_node(nodeid u) {
+    if (!is_terminal(u) && !m_in_worklist[u]) {
+      m_in_worklist[u] = 1;
+      m_next_worklist.push_back(u);
+    }
+  }
+
+  /**
+   * @brief Moves what a thread did in a round to the shared state
+   */
+  void flush_context(contraction_context &ctx) {
+    for (nodeid u : ctx.touched) {
+      enqueue_node(u);
+    }
+    ctx.touched.clear();
+    m_eliminated_nodes.insert(m_eliminated_nodes.end(), ctx.eliminated.begin(),
+                              ctx.eliminated.end());
+    ctx.eliminated.clear();
+    m_constant_flow += ctx.constant_flow;
+    ctx.constant_flow = 0;
   }
 
-  void contract_edge(nodeid u, nodeid v) {
+  /**
+   * @brief Contracts the arc (u,v). Only u, v and their neighbors are read or
+   * written, so contractions with disjoint closed neighborhoods can run
+   * concurrently.
+   */
+  void contract_edge(nodeid u, nodeid v, contraction_context &ctx) {
+    // union by size, terminals always stay the root
+    if (!is_terminal(v) && m_super_node_size[u] > m_super_node_size[v]) {
+      std::swap(u, v);
+    }
     // contract u into v
     m_super_node[u] = v;
-    adjacency_map &umap = m_adj[u];
-    adjacency_map &vmap = m_adj[v];
-    for (auto &it : umap) {
-      nodeid t = it.first;
-      if (t == v)
-        continue;
-      //      fprintf(stderr, "curr: %d, rewiring (%d,%d) ->
-      //      (%d,%d)\n",u,u,v,t,v);
-      flow f = it.second;
-      m_adj[t][v] += f;
-      m_adj[v][t] += f;
-      m_total_cap_at_node[v] += f;
-      m_adj[t].erase(u); // get rid of any trace of u
+    const adjacency_arc *ubegin = m_adjacency.arcs(u), *uend = ubegin + m_adjacency.degree(u);
+    if (is_terminal(v)) {
+      // arcs of u become terminal arcs of its neighbors, the terminal arcs
+      // of u are either self loops or source-sink arcs and are dropped
+      std::vector<flow> &tcap = (v == SOURCEID) ? m_source_cap : m_sink_cap;
+      ctx.constant_flow += (v == SOURCEID) ? m_sink_cap[u] : m_source_cap[u];
+      for (const adjacency_arc *it = ubegin; it != uend; ++it) {
+        tcap[it->head] += it->f;
+        m_adjacency.erase(it->head, m_adjacency.find(it->head, u));
+        cancel_terminal_caps(it->head, ctx.constant_flow);
+        ctx.touched.push_back(it->head);
+      }
+    } else {
+      flow uv = 0;
+      for (const adjacency_arc *it = ubegin; it != uend; ++it) {
+        if (it->head == v) {
+          uv = it->f;
+          continue;
+        }
+        adjacency_arc moved = {v, it->f};
+        m_adjacency.rewire(it->head, u, moved);
+      }
+      m_adjacency.merge(u, v, ctx.merge_buffer, ctx.arena);
+      m_source_cap[v] += m_source_cap[u];
+      m_sink_cap[v] += m_sink_cap[u];
+      m_total_cap_at_node[v] += m_total_cap_at_node[u] - 2 * uv;
+      cancel_terminal_caps(v, ctx.constant_flow);
+      m_super_node_size[v] += m_super_node_size[u];
+      ctx.touched.push_back(v);
+      for (nodeid k = 0; k < m_adjacency.degree(v); ++k) {
+        ctx.touched.push_back(m_adjacency.arcs(v)[k].head);
+      }
     }
     // u no longer exists
-    vmap.erase(u);
+    m_source_cap[u] = 0;
+    m_sink_cap[u] = 0;
     m_total_cap_at_node[u] = 0;
-    m_total_cap_at_node[v] -= umap[v];
-    umap.clear();
-    //    fprintf(stderr," clearing map of %d\n", u);
+    m_adjacency.clear(u);
   }
 
-  bool contract_node2(nodeid u, double cutoff = 1.) {
-    adjacency_map &umap = m_adj[u];
-    for (auto &it : umap) {
-      nodeid v = it.first;
-      flow f = it.second;
-      flow ff = 0;
-      if ( v == SINKID || v == SOURCEID ) {
-          ff = m_total_cap_at_node[u]-f;
+  /**
+   * @brief Replaces the degree-2 node u by a triangle between its neighbors
+   * and its terminal (Y-Delta). Only u and its neighbors are read or written.
+   */
+  void eliminate_node(nodeid u, contraction_context &ctx) {
+    eliminated_node e;
+    e.u = u;
+    e.v = m_adjacency.arcs(u)[0].head;
+    e.w = m_adjacency.arcs(u)[1].head;
+    e.terminal = m_source_cap[u] > 0 ? SOURCEID : SINKID;
+    e.a = m_adjacency.arcs(u)[0].f;
+    e.b = m_adjacency.arcs(u)[1].f;
+    e.c = m_source_cap[u] + m_sink_cap[u];
+    // separating v alone from u's other neighbors costs min(a, b + c) = a,
+    // and likewise for w and the terminal
+    flow vw = (e.a + e.b - e.c) / 2;
+    std::vector<flow> &tcap =
+        (e.terminal == SOURCEID) ? m_source_cap : m_sink_cap;
+    adjacency_arc to_w = {e.w, vw}, to_v = {e.v, vw};
+    m_adjacency.rewire(e.v, u, to_w);
+    m_adjacency.rewire(e.w, u, to_v);
+    tcap[e.v] += e.a - vw;
+    tcap[e.w] += e.b - vw;
+    cancel_terminal_caps(e.v, ctx.constant_flow);
+    cancel_terminal_caps(e.w, ctx.constant_flow);
+    ctx.touched.push_back(e.v);
+    ctx.touched.push_back(e.w);
+    ctx.eliminated.push_back(e);
+    m_is_eliminated[u] = 1;
+    m_source_cap[u] = 0;
+    m_sink_cap[u] = 0;
+    m_total_cap_at_node[u] = 0;
+    m_adjacency.clear(u);
+  }
+
+  /**
+   * @brief Whether u has degree 2 and can be replaced by a triangle. Its
+   * three capacities must satisfy the triangle inequality, otherwise an arc
+   * of u can be contracted, and for integer flows have an even sum so the
+   * triangle capacities are integers.
+   */
+  bool can_eliminate(nodeid u) const {
+    if (m_adjacency.degree(u) != 2) {
+      return false;
+    }
+    const flow a = m_adjacency.arcs(u)[0].f, b = m_adjacency.arcs(u)[1].f;
+    const flow c = m_source_cap[u] + m_sink_cap[u];
+    if (c <= 0 || a >= b + c || b >= a + c || c >= a + b) {
+      return false;
+    }
+    const flow half = (a + b + c) / 2;
+    return half + half == a + b + c;
+  }
+
+  /**
+   * @brief Padberg-Rinaldi tests on the arc (u,v) with f = c(u,v), the
+   * terminals count as neighbors. Contracting is exact if for a common
+   * neighbor w both u and v have at least half of their capacity on
+   * {(u,v), (u,w)} and {(u,v), (v,w)}: if a minimum cut separated u and v,
+   * moving the one not on the side of w would not increase it. It is also
+   * exact if any cut separating u and v, which cuts at least
+   * f + sum_w min(c(u,w), c(v,w)), is larger than a known cut.
+   */
+  bool triangle_contractible(nodeid u, nodeid v, flow f) const {
+    const flow total_u = m_total_cap_at_node[u];
+    const flow total_v = m_total_cap_at_node[v];
+    const flow su = m_source_cap[u], tu = m_sink_cap[u];
+    const flow sv = m_source_cap[v], tv = m_sink_cap[v];
+    if (f + su >= total_u - f - su && f + sv >= total_v - f - sv) {
+      return true;
+    }
+    if (f + tu >= total_u - f - tu && f + tv >= total_v - f - tv) {
+      return true;
+    }
+    flow separating = f + std::min(su + tv, sv + tu);
+    const adjacency_arc *ui = m_adjacency.arcs(u), *uend = ui + m_adjacency.degree(u);
+    const adjacency_arc *vi = m_adjacency.arcs(v), *vend = vi + m_adjacency.degree(v);
+    while (ui != uend && vi != vend) {
+      if (ui->head < vi->head) {
+        ++ui;
+      } else if (vi->head < ui->head) {
+        ++vi;
       } else {
-          ff = std::min(m_total_cap_at_node[u]-f,m_total_cap_at_node[v]-f);
+        const flow uw = ui->f, vw = vi->f;
+        if (f + uw >= total_u - f - uw && f + vw >= total_v - f - vw) {
+          return true;
+        }
+        separating += std::min(uw, vw);
+        ++ui;
+        ++vi;
+      }
+    }
+    return separating > m_cut_bound;
+  }
+
+  /**
+   * @brief Finds an exact reduction of u: an arc or terminal holding at least
+   * half of the capacity at u (this always applies to nodes of degree 0 or
+   * 1), an arc heavier than a known cut, an arc passing the triangle tests,
+   * or the elimination of u if it has degree 2.
+   *
+   * @return the node to contract u with, u to eliminate it, or NO_NODE
+   */
+  nodeid find_exact_reduction(nodeid u) const {
+    const flow total = m_total_cap_at_node[u];
+    if (m_source_cap[u] >= total - m_source_cap[u]) {
+      return SOURCEID;
+    }
+    if (m_sink_cap[u] >= total - m_sink_cap[u]) {
+      return SINKID;
+    }
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      nodeid v = m_adjacency.arcs(u)[k].head;
+      flow f = m_adjacency.arcs(u)[k].f;
+      if (f >= total - f || f >= m_total_cap_at_node[v] - f ||
+          f > m_cut_bound) {
+        return v;
       }
-      if (ff/double(f) < cutoff) {
-        contract_edge(std::min(u, v), std::max(u, v));
-        return true;
+    }
+    if (can_eliminate(u)) {
+      return u;
+    }
+    if (m_adjacency.degree(u) > TRIANGLE_MAX_DEGREE) {
+      return NO_NODE;
+    }
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      nodeid v = m_adjacency.arcs(u)[k].head;
+      if (m_adjacency.degree(v) <= TRIANGLE_MAX_DEGREE &&
+          triangle_contractible(u, v, m_adjacency.arcs(u)[k].f)) {
+        return v;
       }
     }
-    return false;
+    return NO_NODE;
   }
 
-  bool contract_node(nodeid u) {
-    flow total_cap = m_total_cap_at_node[u];
-    adjacency_map &umap = m_adj[u];
-    for (auto &it : umap) {
-      nodeid v = it.first;
-      flow f = it.second;
-      if (f > total_cap - f) {
-        contract_edge(std::min(u, v), std::max(u, v));
-        //        fprintf(stderr,"contracting edge (%d,%d)\n",std::min(u, v),
-        //        std::max(u, v));
-        return true;
+  /**
+   * @brief Finds an exact reduction of u or else an arc of u that may be
+   * contracted under the given cutoff.
+   *
+   * @return the node to contract u with, u to eliminate it, or NO_NODE
+   */
+  nodeid find_contraction(nodeid u, double cutoff) const {
+    nodeid exact = find_exact_reduction(u);
+    if (exact != NO_NODE || cutoff <= 1.) {
+      return exact;
+    }
+    const flow total = m_total_cap_at_node[u];
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      nodeid v = m_adjacency.arcs(u)[k].head;
+      flow f = m_adjacency.arcs(u)[k].f;
+      flow ff = std::min(total - f, m_total_cap_at_node[v] - f);
+      if (ff / double(f) < cutoff) {
+        return v;
       }
     }
-    return false;
+    if (m_source_cap[u] > 0 &&
+        (total - m_source_cap[u]) / double(m_source_cap[u]) < cutoff) {
+      return SOURCEID;
+    }
+    if (m_sink_cap[u] > 0 &&
+        (total - m_sink_cap[u]) / double(m_sink_cap[u]) < cutoff) {
+      return SINKID;
+    }
+    return NO_NODE;
   }
 
-  void contract_graph2() {
-    init_graph_contraction();
+  /**
+   * @brief Applies what find_contraction returned for u
+   */
+  void reduce_node(nodeid u, nodeid v, contraction_context &ctx) {
+    if (v == u) {
+      eliminate_node(u, ctx);
+    } else {
+      contract_edge(std::min(u, v), std::max(u, v), ctx);
+    }
+  }
+
+  bool contract_node2(nodeid u, double cutoff = 1.) {
+    nodeid v = find_contraction(u, cutoff);
+    if (v == NO_NODE) {
+      return false;
+    }
+    reduce_node(u, v, m_contexts[0]);
+    flush_context(m_contexts[0]);
+    return true;
+  }
+
+  /**
+   * @brief Tests every node of the worklist in turn, contracting as it goes.
+   *
+   * @return number of contracted arcs
+   */
+  nodeid contract_round(double cutoff) {
     nodeid num_contracted = 0;
-    bool change;
-    double cutoffs[] = {1.,1.1,1.2,1.3,1.4,1.5,};
-//    double cutoffs[] = {1.,};
-    int ncutoffs = sizeof(cutoffs) / sizeof(double);
-
-    for ( int icutoff = 0; icutoff < ncutoffs; ++icutoff ) {
-      double cutoff = cutoffs[icutoff];
-      do {
-        change = false;
-        for (nodeid id = 0; id < BaseGraph::m_nnode - 2; ++id) {
-          if (m_super_node[id] == id) { // is a supernode
-            bool success = contract_node2(id,cutoff);
-            change |= success;
-            if (success) {
-              num_contracted++;
-            }
-          }
-        }
-      } while (change);
+    for (nodeid id : m_worklist) {
+      m_in_worklist[id] = 0;
+      if (is_super_node(id) && contract_node2(id, cutoff)) {
+        num_contracted++;
+      }
     }
+    return num_contracted;
+  }
 
-    fprintf(stderr, "number contracted: %d\n", num_contracted);
-    nodeid num_supernode = 0;
-    for (nodeid id = 0; id < BaseGraph::m_nnode; ++id) {
-      if (m_super_node[id] == id) { // is a supernode
-        num_supernode++;
+  /**
+   * @brief Calls fn on every node that contracting (u,v), or eliminating u
+   * when v == u, reads or writes: u, v and all their neighbors. Terminals
+   * hold no shared state and are left out.
+   */
+  template <typename Function>
+  void for_each_affected_node(nodeid u, nodeid v, Function fn) const {
+    fn(u);
+    for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+      fn(m_adjacency.arcs(u)[k].head);
+    }
+    if (!is_terminal(v) && v != u) {
+      fn(v);
+      for (nodeid k = 0; k < m_adjacency.degree(v); ++k) {
+        fn(m_adjacency.arcs(v)[k].head);
       }
     }
+  }
 
-    fprintf(stderr, "number supernode: %d\n", num_supernode);
-    fprintf(stderr, "number original: %d\n", BaseGraph::m_nnode);
+  /**
+   * @brief Parallel version of contract_round.
+   *
+   * Every node on the worklist looks for a contractible arc. Each candidate
+   * claims the closed neighborhood of its arc, the lowest node id wins a
+   * claimed node, and candidates that won all of their nodes form an
+   * independent set that is contracted concurrently. The other candidates
+   * are retried in the next round. As contractions in a round touch disjoint
+   * nodes, each one sees the same graph it was tested on, so the exact rule
+   * (cutoff == 1) keeps its guarantee.
+   *
+   * @return number of contracted arcs
+   */
+  nodeid contract_round_parallel(double cutoff) {
+    util::ThreadPool &pool = *m_pool;
+    const size_t nwork = m_worklist.size();
+    const unsigned long long round = ++m_round << 32;
+    m_candidate.resize(nwork);
+    m_selected.assign(nwork, 0);
+    pool.parallel_for(0, nwork, 256, [&](size_t i, unsigned) {
+      nodeid u = m_worklist[i];
+      m_in_worklist[u] = 0;
+      nodeid v = NO_NODE;
+      if (is_super_node(u)) {
+        v = find_contraction(u, cutoff);
+      }
+      m_candidate[i] = v;
+      if (v == NO_NODE) {
+        return;
+      }
+      const unsigned long long key = round | (unsigned long long)u;
+      for_each_affected_node(u, v, [&](nodeid x) {
+        std::atomic<unsigned long long> &claim = m_claims[x];
+        unsigned long long old = claim.load(std::memory_order_relaxed);
+        while ((old < round || old > key) &&
+               !claim.compare_exchange_weak(old, key)) {
+        }
+      });
+    });
+    pool.parallel_for(0, nwork, 256, [&](size_t i, unsigned) {
+      nodeid u = m_worklist[i], v = m_candidate[i];
+      if (v == NO_NODE) {
+        return;
+      }
+      const unsigned long long key = round | (unsigned long long)u;
+      bool owned = true;
+      for_each_affected_node(u, v, [&](nodeid x) {
+        owned &= m_claims[x].load(std::memory_order_relaxed) == key;
+      });
+      m_selected[i] = owned;
+    });
+    pool.parallel_for(0, nwork, 64, [&](size_t i, unsigned thread_id) {
+      nodeid u = m_worklist[i], v = m_candidate[i];
+      if (v == NO_NODE) {
+        return;
+      }
+      contraction_context &ctx = m_contexts[thread_id];
+      if (m_selected[i]) {
+        reduce_node(u, v, ctx);
+      } else {
+        ctx.touched.push_back(u);
+      }
+    });
+    for (contraction_context &ctx : m_contexts) {
+      flush_context(ctx);
+    }
+    return nodeid(std::count(m_selected.begin(), m_selected.end(), 1));
   }
 
-  void contract_graph() {
-    init_graph_contraction();
+  /**
+   * @brief Contracts arcs under the given cutoff until no node can be
+   * contracted or the round limit is hit. After the first round only nodes
+   * whose neighborhood changed since they were last tested are tested again.
+   *
+   * @return number of contracted arcs and eliminated nodes
+   */
+  nodeid contract_to_fixed_point(double cutoff) {
     nodeid num_contracted = 0;
-    bool change;
-    do {
-      change = false;
-      for (nodeid id = 0; id < BaseGraph::m_nnode - 2; ++id) {
-        if (m_super_node[id] == id) { // is a supernode
-          bool success = contract_node(id);
-          change |= success;
-          if (success) {
-            num_contracted++;
-          }
+    double source_cut = 0, sink_cut = 0;
+    for (nodeid id = 0; id < BaseGraph::m_nnode - 2; ++id) {
+      if (is_super_node(id)) {
+        enqueue_node(id);
+        source_cut += double(m_source_cap[id]);
+        sink_cut += double(m_sink_cap[id]);
+      }
+    }
+    m_cut_bound = (cutoff <= 1.) ? std::min(source_cut, sink_cut)
+                                 : std::numeric_limits<double>::infinity();
+    for (int round = 0; !m_next_worklist.empty(); ++round) {
+      if (m_options.max_rounds > 0 && round >= m_options.max_rounds) {
+        for (nodeid id : m_next_worklist) {
+          m_in_worklist[id] = 0;
         }
+        m_next_worklist.clear();
+        break;
       }
-    } while (change);
-
-    fprintf(stderr, "number contracted: %d\n", num_contracted);
-    nodeid num_supernode = 0;
-    for (nodeid id = 0; id < BaseGraph::m_nnode; ++id) {
-      if (m_super_node[id] == id) { // is a supernode
-        num_supernode++;
+      m_worklist.swap(m_next_worklist);
+      m_next_worklist.clear();
+      if (m_pool && m_worklist.size() >= PARALLEL_MIN_WORKLIST) {
+        num_contracted += contract_round_parallel(cutoff);
+      } else {
+        num_contracted += contract_round(cutoff);
       }
+      m_stats.rounds++;
     }
+    return num_contracted;
+  }
 
-    fprintf(stderr, "number supernode: %d\n", num_supernode);
-    fprintf(stderr, "number original: %d\n", BaseGraph::m_nnode);
+  void contract_graph() {
+    init_graph_contraction();
+    if (m_options.exact_only) {
+      m_stats.contracted += contract_to_fixed_point(1.);
+      return;
+    }
+    for (double cutoff : m_options.cutoffs) {
+      m_stats.contracted += contract_to_fixed_point(cutoff);
+    }
   }
 
   nodeid count_supernodes() const {
     nodeid num_supernode = 0;
     for (nodeid id = 0; id < BaseGraph::m_nnode; ++id) {
-      if (m_super_node[id] == id) { // is a supernode
+      if (is_super_node(id)) {
         num_supernode++;
       }
     }
@@ -228,10 +701,8 @@ private:
   arcid count_arcs() const {
     arcid num_arc = 0;
     for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
-      const adjacency_map &umap = m_adj[u];
-      for (auto &it : umap) {
-        nodeid v = it.first;
-        if (u < v) {
+      for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+        if (u < m_adjacency.arcs(u)[k].head) {
           num_arc++;
         }
       }
@@ -241,11 +712,7 @@ private:
 
   void resolve_super_nodes() {
     for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
-      nodeid v = m_super_node[u];
-      while (v != m_super_node[v]) {
-        v = m_super_node[v];
-      }
-      m_super_node[u] = v;
+      util::find_root(m_super_node, u);
     }
   }
 
@@ -253,78 +720,60 @@ private:
     m_new_super_node_id.assign(BaseGraph::m_nnode, -1);
     nodeid super_node_count = 0;
     for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
-      if (m_super_node[u] == u) { // is a supernode
+      if (is_super_node(u)) {
         m_new_super_node_id[u] = super_node_count++;
       } else {
-        if (m_adj[u].size() > 0) {
-          //      fprintf(stderr, "non-supernode with edges: %d\n", u);
-          assert(false);
-        }
-      }
-    }
-  }
-
-  void simplify_st_arcs() {
-    adjacency_map &smap = m_adj[SOURCEID];
-    smap.erase(SINKID);
-    adjacency_map &tmap = m_adj[SINKID];
-    tmap.erase(SOURCEID);
-    for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
-      adjacency_map &umap = m_adj[u];
-      if (umap.find(SOURCEID) != umap.end() &&
-          umap.find(SINKID) != umap.end()) {
-        flow &sflow = umap[SOURCEID];
-        flow &tflow = umap[SINKID];
-        if (sflow > tflow) { // source wins
-          sflow -= tflow;
-          smap[u] -= tflow;
-          umap.erase(SINKID);
-          tmap.erase(u);
-        } else if (sflow < tflow) { // sink wins
-          tflow -= sflow;
-          tmap[u] -= sflow;
-          umap.erase(SOURCEID);
-          smap.erase(u);
-        } else { // erase everthing
-          umap.erase(SOURCEID);
-          smap.erase(u);
-          umap.erase(SINKID);
-          tmap.erase(u);
-        }
+        assert(m_adjacency.degree(u) == 0);
       }
     }
   }
 
   void add_arcs(GraphMaxflow &g) const {
     for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
-      const adjacency_map &umap = m_adj[u];
-      for (auto &it : umap) {
-        nodeid v = it.first;
-        flow f = it.second;
-        if (u < v && (v < BaseGraph::m_nnode - 2)) {
+      for (nodeid k = 0; k < m_adjacency.degree(u); ++k) {
+        nodeid v = m_adjacency.arcs(u)[k].head;
+        flow f = m_adjacency.arcs(u)[k].f;
+        if (u < v) {
           g.add_arc(m_new_super_node_id[u], m_new_super_node_id[v], f, f);
         }
       }
     }
-    { // add source capacities
-      const adjacency_map &smap = m_adj[SOURCEID];
-      for (auto &it : smap) {
-        nodeid v = it.first;
-        flow f = it.second;
-        g.set_tweights(m_new_super_node_id[v], f, 0);
+    // add source/sink capacities
+    for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
+      if (m_source_cap[u] > 0 || m_sink_cap[u] > 0) {
+        g.set_tweights(m_new_super_node_id[u], m_source_cap[u], m_sink_cap[u]);
       }
     }
-    { // add sink capacities
-      const adjacency_map &smap = m_adj[SINKID];
-      for (auto &it : smap) {
-        nodeid v = it.first;
-        flow f = it.second;
-        g.set_tweights(m_new_super_node_id[v], 0, f);
-      }
+  }
+
+  /**
+   * @brief Segment of the supernode u was contracted into, once placed
+   */
+  bool super_node_segment(nodeid u) const {
+    nodeid sn = m_super_node[u];
+    return is_terminal(sn) ? sn == SINKID : bool(m_what_segment[sn]);
+  }
+
+  /**
+   * @brief Places the eliminated nodes, in reverse order of elimination so
+   * the neighbors of each are placed first, on their cheaper side.
+   */
+  void place_eliminated_nodes() {
+    for (size_t i = m_eliminated_nodes.size(); i-- > 0;) {
+      const eliminated_node &e = m_eliminated_nodes[i];
+      // capacity cut if u is on the source side
+      flow to_sink = (super_node_segment(e.v) ? e.a : 0) +
+                     (super_node_segment(e.w) ? e.b : 0) +
+                     (e.terminal == SINKID ? e.c : 0);
+      m_what_segment[e.u] = e.a + e.b + e.c - to_sink < to_sink;
     }
   }
 
-  void get_what_segments(GraphMaxflow &g) {
+  /**
+   * @brief Sets the segment of every node, g is the solved contracted graph
+   * or null if every node was contracted or eliminated
+   */
+  void get_what_segments(GraphMaxflow *g) {
     m_what_segment.assign(BaseGraph::m_nnode - 2, false);
     for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
       nodeid sn = m_super_node[u];
@@ -332,49 +781,79 @@ private:
         m_what_segment[u] = true;
       } else if (sn == SOURCEID) {
         m_what_segment[u] = false;
-      } else {
+      } else if (!m_is_eliminated[sn]) {
         nodeid nu = m_new_super_node_id[sn];
-        m_what_segment[u] = g.what_segment(nu);
+        m_what_segment[u] = g->what_segment(nu);
+      }
+    }
+    place_eliminated_nodes();
+    // nodes contracted into a node that was eliminated afterwards
+    for (nodeid u = 0; u < BaseGraph::m_nnode - 2; ++u) {
+      nodeid sn = m_super_node[u];
+      if (sn != u && !is_terminal(sn) && m_is_eliminated[sn]) {
+        m_what_segment[u] = m_what_segment[sn];
       }
     }
   }
 
 public:
-  UndirectedGraphSlimCuts(nodeid nnode)
-      : BaseGraph(nnode + 2), m_adj(BaseGraph::m_nnode),
-        SOURCEID(BaseGraph::m_nnode - 2), SINKID(BaseGraph::m_nnode - 1) {}
+  /**
+   * @brief UndirectedGraphSlimCuts class constructor
+   *
+   * @param nnode number of nodes in the graph
+   * @param options how to contract the graph before solving
+   */
+  UndirectedGraphSlimCuts(nodeid nnode,
+                          const SlimCutsOptions &options = SlimCutsOptions())
+      : BaseGraph(nnode + 2), SOURCEID(BaseGraph::m_nnode - 2),
+        SINKID(BaseGraph::m_nnode - 1), NO_NODE(nodeid(-1)),
+        m_source_cap(nnode, 0), m_sink_cap(nnode, 0), m_constant_flow(0),
+        m_cut_bound(0), m_round(0), m_options(options) {}
+
+  /**
+   * @brief Sets the contraction options used by the next maxflow call
+   */
+  void set_options(const SlimCutsOptions &options) { m_options = options; }
+
+  const SlimCutsOptions &options() const { return m_options; }
+
+  /**
+   * @brief Statistics of the last maxflow call
+   */
+  const SlimCutsStats &stats() const { return m_stats; }
 
   void add_arc(nodeid s, nodeid t, cap c) {
-    if (c > 0) {
-      add_to_adj_map(s, t, c);
-      add_to_adj_map(t, s, c);
+    if (c > 0 && s != t) {
+      input_arc a = {s, t, c};
+      m_input_arcs.push_back(a);
     }
   }
 
   void set_tweights(nodeid s, cap scap, cap tcap) {
     if (scap > 0) {
-      add_to_adj_map(s, SOURCEID, scap);
-      add_to_adj_map(SOURCEID, s, scap);
+      m_source_cap[s] = scap;
     }
     if (tcap > 0) {
-      add_to_adj_map(s, SINKID, tcap);
-      add_to_adj_map(SINKID, s, tcap);
+      m_sink_cap[s] = tcap;
     }
   }
 
   flow maxflow() {
+    m_stats = SlimCutsStats();
+    m_stats.nodes_before = size_t(BaseGraph::m_nnode - 2);
 
-#if USE_PROBABILISTIC_CONTRACTION == 0
+    util::Timer timer_contraction;
+    timer_contraction.tic();
     contract_graph();
-#else
-    contract_graph2();
-#endif
     resolve_super_nodes();
 
+    m_stats.eliminated = m_eliminated_nodes.size();
     nodeid num_node = count_supernodes() - 2; // don't count source/sink
-    if (!num_node) {
-      m_what_segment.assign(BaseGraph::m_nnode - 2, false);
-      return 0;
+    if (!num_node) { // every node was contracted or eliminated
+      get_what_segments(nullptr);
+      timer_contraction.toc();
+      m_stats.contraction_seconds = timer_contraction.elapsed_seconds();
+      return m_constant_flow;
     }
     arcid num_arc = count_arcs();
 
@@ -382,19 +861,25 @@ public:
     // sets new ids to use that are collapsed to contigious in a range
     set_new_super_node_id();
 
-    simplify_st_arcs();
+    timer_contraction.toc();
+    m_stats.contraction_seconds = timer_contraction.elapsed_seconds();
+    m_stats.nodes_after = size_t(num_node);
+    m_stats.arcs_after = size_t(num_arc);
 
-    util::Timer timer_real_maxflow;
+    util::Timer timer_build, timer_solve;
+    timer_build.tic();
     GraphMaxflow graph(num_node, num_arc);
     add_arcs(graph);
-    timer_real_maxflow.tic();
+    timer_build.toc();
+    timer_solve.tic();
     flow f = graph.maxflow();
-    timer_real_maxflow.toc();
-    fprintf(stderr, "real_maxflow_time: %f\n", timer_real_maxflow.elapsed_seconds());
+    timer_solve.toc();
+    m_stats.build_seconds = timer_build.elapsed_seconds();
+    m_stats.solve_seconds = timer_solve.elapsed_seconds();
 
-    get_what_segments(graph);
+    get_what_segments(&graph);
 
-    return f;
+    return f + m_constant_flow;
   }
 
   bool what_segment(nodeid s) { return m_what_segment[s]; }
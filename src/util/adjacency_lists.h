@@ -0,0 +1,229 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file adjacency_lists.h
+ *
+ * @brief Sorted neighbor lists and union-find shared by the graph reductions
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-04
+ *
+ */
+#ifndef UTILADJACENCYLISTS_H
+#define UTILADJACENCYLISTS_H
+
+#include "util/block_arena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace util {
+
+/**
+ * @brief Root of u in a union-find forest, compressing the path to it
+ *
+ * @param parent parent of every element, roots are their own parent
+ */
+template <typename Id> Id find_root(std::vector<Id> &parent, Id u) {
+  Id root = u;
+  while (root != parent[root]) {
+    root = parent[root];
+  }
+  while (u != root) { // path compression
+    Id next = parent[u];
+    parent[u] = root;
+    u = next;
+  }
+  return root;
+}
+
+/**
+ * @brief Neighbor lists kept sorted by head, built in one CSR array and
+ * moved to a BlockArena when contracting a node outgrows its slot. Arc is
+ * any struct with a head member and add(const Arc &) summing the capacities
+ * of a parallel arc into it.
+ *
+ * Contracting only touches the lists of the contracted nodes and of their
+ * neighbors, so contractions with disjoint closed neighborhoods can run
+ * concurrently, each with its own arena and merge buffer.
+ */
+template <typename Arc, typename Id> class AdjacencyLists {
+
+private:
+  // neighbor list of node u is [m_adj[u], m_adj[u] + m_degree[u])
+  std::vector<Arc> m_csr;
+  std::vector<Arc *> m_adj;
+  std::vector<Id> m_degree;
+  std::vector<Id> m_capacity;
+
+  static bool head_less(const Arc &a, const Arc &b) { return a.head < b.head; }
+
+public:
+  /**
+   * @brief Builds the lists of n nodes from a list of arcs, summing the
+   * capacities of arcs between the same pair of nodes
+   *
+   * @param input arcs with s and t members
+   * @param to_arcs to_arcs(a, out_of_s, out_of_t) fills the entries of an
+   * input arc in the lists of a.s and a.t
+   *
+   * @return the number of entries over all lists after merging
+   */
+  template <typename InputArc, typename ToArcs>
+  size_t build(Id n, const std::vector<InputArc> &input, ToArcs to_arcs) {
+    m_degree.assign(n, 0);
+    for (const InputArc &a : input) {
+      m_degree[a.s]++;
+      m_degree[a.t]++;
+    }
+    m_capacity = m_degree;
+    m_csr.resize(2 * input.size());
+    m_adj.assign(n, nullptr);
+    size_t offset = 0;
+    for (Id u = 0; u < n; ++u) {
+      m_adj[u] = m_csr.data() + offset;
+      offset += m_degree[u];
+      m_degree[u] = 0;
+    }
+    for (const InputArc &a : input) {
+      Arc sa, ta;
+      to_arcs(a, sa, ta);
+      m_adj[a.s][m_degree[a.s]++] = sa;
+      m_adj[a.t][m_degree[a.t]++] = ta;
+    }
+    size_t narc = 0;
+    for (Id u = 0; u < n; ++u) {
+      Arc *begin = m_adj[u], *end = begin + m_degree[u];
+      std::sort(begin, end, head_less);
+      Arc *out = begin;
+      for (Arc *it = begin; it != end; ++it) {
+        if (out != begin && (out - 1)->head == it->head) {
+          (out - 1)->add(*it);
+        } else {
+          *out++ = *it;
+        }
+      }
+      m_degree[u] = Id(out - begin);
+      narc += size_t(m_degree[u]);
+    }
+    return narc;
+  }
+
+  Id degree(Id u) const { return m_degree[u]; }
+
+  Arc *arcs(Id u) { return m_adj[u]; }
+
+  const Arc *arcs(Id u) const { return m_adj[u]; }
+
+  /**
+   * @brief Empties the list of a node contracted away
+   */
+  void clear(Id u) { m_degree[u] = 0; }
+
+  /**
+   * @brief The arc from u to v, NULL if there is none
+   */
+  Arc *find(Id u, Id v) {
+    Arc *begin = m_adj[u], *end = begin + m_degree[u];
+    Arc key = Arc();
+    key.head = v;
+    Arc *it = std::lower_bound(begin, end, key, head_less);
+    return (it != end && it->head == v) ? it : nullptr;
+  }
+
+  void erase(Id u, Arc *a) {
+    assert(a);
+    Arc *end = m_adj[u] + m_degree[u];
+    std::copy(a + 1, end, a);
+    m_degree[u]--;
+  }
+
+  /**
+   * @brief Replaces the arc from t to u by arc, whose head is the node v that
+   * u was contracted into, summing it into an already existing arc (t,v)
+   */
+  void rewire(Id t, Id u, const Arc &arc) {
+    Arc *au = find(t, u);
+    assert(au);
+    Arc *begin = m_adj[t], *end = begin + m_degree[t];
+    Arc *pos = std::lower_bound(begin, end, arc, head_less);
+    if (pos != end && pos->head == arc.head) {
+      pos->add(arc);
+      erase(t, au);
+      return;
+    }
+    // move the arc to its sorted position
+    if (pos > au) {
+      std::copy(au + 1, pos, au);
+      *(pos - 1) = arc;
+    } else {
+      std::copy_backward(pos, au, au + 1);
+      *pos = arc;
+    }
+  }
+
+  /**
+   * @brief Merges the list of u into the one of v, dropping the arcs between
+   * u and v and summing parallel arcs. The list of u is left as it was.
+   *
+   * @param merged scratch buffer
+   * @param arena storage for the list of v if it outgrows its slot
+   */
+  void merge(Id u, Id v, std::vector<Arc> &merged,
+             BlockArena<Arc> &arena) {
+    const Arc *ui = m_adj[u], *uend = ui + m_degree[u];
+    const Arc *vi = m_adj[v], *vend = vi + m_degree[v];
+    merged.clear();
+    while (ui != uend || vi != vend) {
+      if (vi == vend || (ui != uend && ui->head < vi->head)) {
+        if (ui->head != v)
+          merged.push_back(*ui);
+        ++ui;
+      } else if (ui == uend || vi->head < ui->head) {
+        if (vi->head != u)
+          merged.push_back(*vi);
+        ++vi;
+      } else {
+        Arc a = *vi;
+        a.add(*ui);
+        merged.push_back(a);
+        ++ui;
+        ++vi;
+      }
+    }
+    Id degree = Id(merged.size());
+    if (degree > m_capacity[v]) {
+      m_capacity[v] = std::max(degree, 2 * m_capacity[v]);
+      m_adj[v] = arena.allocate(m_capacity[v]);
+    }
+    std::copy(merged.begin(), merged.end(), m_adj[v]);
+    m_degree[v] = degree;
+  }
+
+  /**
+   * @brief Bytes held by the CSR and the per node arrays, the arenas are
+   * owned by the callers
+   */
+  size_t memory_bytes() const {
+    return m_csr.capacity() * sizeof(Arc) + m_adj.capacity() * sizeof(Arc *) +
+           (m_degree.capacity() + m_capacity.capacity()) * sizeof(Id);
+  }
+};
+}
+
+#endif // UTILADJACENCYLISTS_H
@@ -0,0 +1,66 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file block_arena.h
+ *
+ * @brief An arena handing out arrays from large blocks
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-04
+ *
+ */
+#ifndef UTILBLOCKARENA_H
+#define UTILBLOCKARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace util {
+
+/**
+ * @brief Hands out arrays of T from large blocks, used for neighbor lists
+ * that outgrow their slot. Blocks are never resized, so handed out pointers
+ * stay valid until clear().
+ */
+template <typename T, size_t BLOCK_SIZE = (1 << 16)> class BlockArena {
+
+private:
+  std::vector<std::vector<T>> m_blocks;
+  size_t m_used;
+
+public:
+  BlockArena() : m_used(0) {}
+
+  void clear() {
+    m_blocks.clear();
+    m_used = 0;
+  }
+
+  T *allocate(size_t n) {
+    if (m_blocks.empty() || m_used + n > m_blocks.back().size()) {
+      m_blocks.emplace_back(std::max(n, BLOCK_SIZE));
+      m_used = 0;
+    }
+    T *a = &m_blocks.back()[m_used];
+    m_used += n;
+    return a;
+  }
+};
+}
+
+#endif // UTILBLOCKARENA_H
@@ -0,0 +1,74 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file mapped_file.cpp
+ *
+ * @brief A read-only memory mapped file, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-11
+ *
+ */
+
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace util {
+
+MappedFile::MappedFile(const std::string &filename)
+    : m_data(nullptr), m_size(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("failed to open file for reading: " + filename +
+                             ": " + std::strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    int err = errno;
+    close(fd);
+    throw std::runtime_error("failed to stat file: " + filename + ": " +
+                             std::strerror(err));
+  }
+  m_size = size_t(st.st_size);
+  if (m_size > 0) {
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      int err = errno;
+      close(fd);
+      throw std::runtime_error("failed to map file: " + filename + ": " +
+                               std::strerror(err));
+    }
+    // read front to back
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char *>(data);
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (m_data) {
+    munmap(const_cast<char *>(m_data), m_size);
+  }
+}
+}
@@ -0,0 +1,61 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file mapped_file.h
+ *
+ * @brief A read-only memory mapped file, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-11
+ *
+ */
+#ifndef UTILMAPPEDFILE_H
+#define UTILMAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace util {
+
+class MappedFile {
+
+private:
+  const char *m_data;
+  size_t m_size;
+
+public:
+  /**
+   * @brief Maps a whole file read-only
+   *
+   * @param filename the file
+   *
+   * @throws std::runtime_error if the file can not be opened or mapped
+   */
+  explicit MappedFile(const std::string &filename);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const { return m_data; }
+
+  size_t size() const { return m_size; }
+};
+}
+
+#endif // UTILMAPPEDFILE_H
@@ -0,0 +1,211 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file memory_stats.cpp
+ *
+ * @brief Heap allocation counts from an interposed allocator and the peak
+ * resident set size of the process, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-14
+ *
+ */
+
+#include "memory_stats.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __GLIBC__
+#include <cerrno>
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+namespace {
+
+std::atomic<size_t> g_allocs(0);
+std::atomic<size_t> g_bytes(0);
+std::atomic<size_t> g_live_bytes(0);
+std::atomic<size_t> g_peak_bytes(0);
+
+/**
+ * @brief Reads a "Name:   123 kB" line of /proc/self/status
+ */
+size_t read_status_kb(const char *name) {
+  FILE *file = fopen("/proc/self/status", "r");
+  if (!file) {
+    return 0;
+  }
+  char line[256];
+  size_t len = strlen(name), kb = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (strncmp(line, name, len) == 0 && line[len] == ':') {
+      sscanf(line + len + 1, "%zu", &kb);
+      break;
+    }
+  }
+  fclose(file);
+  return kb * 1024;
+}
+
+#ifdef __GLIBC__
+void record_alloc(void *p, size_t requested) {
+  if (!p) {
+    return;
+  }
+  size_t size = malloc_usable_size(p);
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  g_bytes.fetch_add(requested, std::memory_order_relaxed);
+  size_t live = g_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+  while (live > peak && !g_peak_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+void record_release(size_t size) {
+  g_live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+#endif
+} // namespace
+
+bool alloc_hook_installed() {
+#ifdef __GLIBC__
+  return true;
+#else
+  return false;
+#endif
+}
+
+void reset_alloc_stats() {
+  g_allocs.store(0, std::memory_order_relaxed);
+  g_bytes.store(0, std::memory_order_relaxed);
+  g_peak_bytes.store(g_live_bytes.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+}
+
+AllocStats alloc_stats() {
+  AllocStats stats;
+  stats.allocs = g_allocs.load(std::memory_order_relaxed);
+  stats.bytes = g_bytes.load(std::memory_order_relaxed);
+  stats.peak_bytes = g_peak_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+size_t heap_bytes() { return g_live_bytes.load(std::memory_order_relaxed); }
+
+size_t rss_bytes() { return read_status_kb("VmRSS"); }
+
+size_t peak_rss_bytes() { return read_status_kb("VmHWM"); }
+
+bool reset_peak_rss() {
+  FILE *file = fopen("/proc/self/clear_refs", "w");
+  if (!file) {
+    return false;
+  }
+  bool ok = fputs("5", file) >= 0;
+  return fclose(file) == 0 && ok;
+}
+
+void trim_heap() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+}
+
+#ifdef __GLIBC__
+// glibc's allocator stays reachable under these names, every allocation of
+// the process, operator new included, goes through the functions below
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void *__libc_valloc(size_t size);
+void *__libc_pvalloc(size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size) {
+  void *p = __libc_malloc(size);
+  util::record_alloc(p, size);
+  return p;
+}
+
+void *calloc(size_t count, size_t size) {
+  void *p = __libc_calloc(count, size);
+  util::record_alloc(p, count * size);
+  return p;
+}
+
+void *realloc(void *p, size_t size) {
+  size_t old_size = p ? malloc_usable_size(p) : 0;
+  void *q = __libc_realloc(p, size);
+  if (q || size == 0) { // p was released, also when realloc(p, 0) freed it
+    util::record_release(old_size);
+  }
+  util::record_alloc(q, size);
+  return q;
+}
+
+void free(void *p) {
+  if (p) {
+    util::record_release(malloc_usable_size(p));
+  }
+  __libc_free(p);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  void *p = __libc_memalign(alignment, size);
+  util::record_alloc(p, size);
+  return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size) {
+  if (alignment % sizeof(void *) != 0 ||
+      (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void *q = memalign(alignment, size);
+  if (!q && size) {
+    return ENOMEM;
+  }
+  *p = q;
+  return 0;
+}
+
+void *valloc(size_t size) {
+  void *p = __libc_valloc(size);
+  util::record_alloc(p, size);
+  return p;
+}
+
+void *pvalloc(size_t size) {
+  void *p = __libc_pvalloc(size);
+  util::record_alloc(p, size);
+  return p;
+}
+}
+#endif
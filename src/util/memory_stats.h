@@ -0,0 +1,87 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file memory_stats.h
+ *
+ * @brief Heap allocation counts from an interposed allocator and the peak
+ * resident set size of the process, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-14
+ *
+ */
+#ifndef UTILMEMORYSTATS_H
+#define UTILMEMORYSTATS_H
+
+#include <cstddef>
+
+namespace util {
+
+/**
+ * @brief Heap allocations since the last reset_alloc_stats
+ */
+struct AllocStats {
+  size_t allocs;     // number of malloc, calloc, realloc, ... calls
+  size_t bytes;      // bytes requested by them
+  size_t peak_bytes; // highest number of live heap bytes
+};
+
+/**
+ * @brief Whether the allocator hook is compiled in, it replaces malloc and
+ * friends of glibc for the whole process once memory_stats.cpp is linked
+ * into it. Without the hook every count stays 0.
+ */
+bool alloc_hook_installed();
+
+/**
+ * @brief Restarts the counts, the peak starts from the live heap bytes
+ */
+void reset_alloc_stats();
+
+AllocStats alloc_stats();
+
+/**
+ * @brief Bytes currently allocated on the heap
+ */
+size_t heap_bytes();
+
+/**
+ * @brief Resident set size of the process, 0 if unknown
+ */
+size_t rss_bytes();
+
+/**
+ * @brief Peak resident set size of the process, 0 if unknown
+ */
+size_t peak_rss_bytes();
+
+/**
+ * @brief Restarts the peak resident set size from the current one
+ *
+ * @return false if the kernel does not support it
+ */
+bool reset_peak_rss();
+
+/**
+ * @brief Returns the free memory the allocator holds on to to the system,
+ * so what an earlier run freed is not reused in the resident set of the
+ * next. Only done with glibc.
+ */
+void trim_heap();
+}
+
+#endif // UTILMEMORYSTATS_H
@@ -0,0 +1,94 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file thread_pool.cpp
+ *
+ * @brief A simple fork-join thread pool, implementation
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-02
+ *
+ */
+
+#include "thread_pool.h"
+
+namespace util {
+
+ThreadPool::ThreadPool(unsigned nthreads)
+    : m_generation(0), m_running(0), m_stop(false) {
+  if (nthreads == 0) {
+    nthreads = std::thread::hardware_concurrency();
+  }
+  if (nthreads == 0) {
+    nthreads = 1;
+  }
+  for (unsigned i = 1; i < nthreads; ++i) {
+    m_workers.emplace_back(&ThreadPool::worker_loop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_start_cv.notify_all();
+  for (std::thread &t : m_workers) {
+    t.join();
+  }
+}
+
+void ThreadPool::worker_loop(unsigned thread_id) {
+  unsigned long seen = 0;
+  while (true) {
+    std::function<void(unsigned)> job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start_cv.wait(lock, [&] { return m_stop || m_generation != seen; });
+      if (m_stop) {
+        return;
+      }
+      seen = m_generation;
+      job = m_job;
+    }
+    job(thread_id);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_running == 0) {
+        m_done_cv.notify_one();
+      }
+    }
+  }
+}
+
+void ThreadPool::run(const std::function<void(unsigned)> &job) {
+  if (m_workers.empty()) {
+    job(0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = job;
+    m_running = unsigned(m_workers.size());
+    m_generation++;
+  }
+  m_start_cv.notify_all();
+  job(0);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done_cv.wait(lock, [&] { return m_running == 0; });
+}
+}
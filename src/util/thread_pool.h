@@ -0,0 +1,108 @@
+/**
+ *  This file is part of maxflow-lib.
+ *
+ *  maxflow-lib is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  maxflow-lib is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with maxflow-lib.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @file thread_pool.h
+ *
+ * @brief A simple fork-join thread pool, header
+ *
+ * @author Matt Gara
+ *
+ * @date 2019-09-02
+ *
+ */
+#ifndef UTILTHREADPOOL_H
+#define UTILTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+class ThreadPool {
+
+private:
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_start_cv, m_done_cv;
+  std::function<void(unsigned)> m_job;
+  unsigned long m_generation;
+  unsigned m_running;
+  bool m_stop;
+
+  void worker_loop(unsigned thread_id);
+
+public:
+  /**
+   * @brief Create a pool, the calling thread counts as one of the threads
+   *
+   * @param nthreads total number of threads, 0 uses the hardware concurrency
+   */
+  explicit ThreadPool(unsigned nthreads = 0);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief Number of threads (including the calling thread)
+   */
+  unsigned size() const { return unsigned(m_workers.size()) + 1; }
+
+  /**
+   * @brief Runs job(thread_id) once on every thread, thread_id is in
+   * [0,size()), and returns when all are done. Not reentrant.
+   */
+  void run(const std::function<void(unsigned)> &job);
+
+  /**
+   * @brief Calls fn(i, thread_id) for every i in [begin,end), handing out
+   * chunks of grain indices dynamically.
+   */
+  template <typename Function>
+  void parallel_for(size_t begin, size_t end, size_t grain, Function fn) {
+    if (begin >= end) {
+      return;
+    }
+    if (grain == 0) {
+      grain = 1;
+    }
+    if (size() == 1 || end - begin <= grain) {
+      for (size_t i = begin; i < end; ++i) {
+        fn(i, 0u);
+      }
+      return;
+    }
+    std::atomic<size_t> next(begin);
+    run([&](unsigned thread_id) {
+      size_t chunk;
+      while ((chunk = next.fetch_add(grain)) < end) {
+        size_t chunk_end = (end - chunk < grain) ? end : chunk + grain;
+        for (size_t i = chunk; i < chunk_end; ++i) {
+          fn(i, thread_id);
+        }
+      }
+    });
+  }
+};
+}
+
+#endif // UTILTHREADPOOL_H